@@ -0,0 +1,270 @@
+// backfill: us per Backfill::latest_message, which LCMDataLoader::get_backfill calls for each
+// requested channel, at random times in a log: the binary search for the latest event, the read of
+// that event or sweep, and its transcoding. Each channel the loader would advertise is timed on its
+// own, and then every channel together, as the player asks for them after a seek.
+//
+// usage: backfill [log]
+//
+// Without a log, a synthetic one of 200,000 events is written to the temporary directory: a
+// Velodyne packet every millisecond from a head turning 1.2 degrees per packet, and images, laser
+// scans and poses between them.
+#include "backfill.hpp"
+#include "bench.hpp"
+#include "lcm/lcmtypes_image_t.h"
+#include "lcm/lcmtypes_laser_t.h"
+#include "lcm/lcmtypes_pose_t.h"
+#include "lcm/lcmtypes_velodyne_t.h"
+#include "lcm_views.hpp"
+
+#include <algorithm>
+
+/** As in the loader. */
+constexpr size_t SCAN_WINDOW_SIZE = 4 * 1024 * 1024;
+constexpr size_t ITERATOR_WINDOW_SIZE = 256 * 1024;
+constexpr size_t POSE_WINDOW_SIZE = 4 * 1024;
+
+constexpr size_t BACKFILLS = 200;
+
+/** The transcoders of the registry, which cannot be linked natively because it also names each
+ * type's Foxglove schema. */
+int32_t transcode_image(Transcoder &transcoder, foxglove_data_loader::BytesView in, const char *frame_id,
+                        const PointCloudStages &, std::vector<uint8_t> *out)
+{
+  ImageView view;
+  return view_image(in.ptr, in.len, &view) ? transcoder.transcode_image(view, out, frame_id) : -1;
+}
+
+int32_t transcode_laser(Transcoder &transcoder, foxglove_data_loader::BytesView in, const char *frame_id,
+                        const PointCloudStages &, std::vector<uint8_t> *out)
+{
+  LaserView view;
+  return view_laser(in.ptr, in.len, &view) ? transcoder.transcode_laser_scan(view, out, frame_id) : -1;
+}
+
+int32_t transcode_pose(Transcoder &transcoder, foxglove_data_loader::BytesView in, const char *frame_id,
+                       const PointCloudStages &, std::vector<uint8_t> *out)
+{
+  PoseView view;
+  return view_pose(in.ptr, in.len, &view) ? transcoder.transcode_pose(view, out, frame_id) : -1;
+}
+
+int32_t transcode_velodyne(Transcoder &transcoder, foxglove_data_loader::BytesView in, const char *frame_id,
+                           const PointCloudStages &stages, std::vector<uint8_t> *out)
+{
+  VelodyneView view;
+  return view_velodyne(in.ptr, in.len, &view) ? transcoder.transcode_point_cloud(view, out, frame_id, stages) : -1;
+}
+
+/** Writes the synthetic log described above and returns its path. */
+std::string write_backfill_log(uint64_t count)
+{
+  std::string path = (std::filesystem::temp_directory_path() / "lcm-bench-backfill.lcm").string();
+  FILE *f = fopen(path.c_str(), "wb");
+  if (f == nullptr)
+  {
+    perror(path.c_str());
+    exit(1);
+  }
+  std::mt19937 rng(1);
+  std::vector<uint8_t> jpeg(20000);
+  for (uint8_t &byte : jpeg)
+  {
+    byte = uint8_t(rng());
+  }
+  std::vector<float> ranges(181, 10.0f);
+  uint16_t azimuth = 0;
+  std::vector<uint8_t> payload;
+  std::vector<uint8_t> event;
+  for (uint64_t i = 0; i < count; i++)
+  {
+    int64_t utime = 1000000000000 + int64_t(i) * 1000;
+    const char *channel;
+    if (i % 1000 == 0)
+    {
+      lcmtypes_image_t msg = {.utime = utime, .width = 376, .height = 240, .size = int32_t(jpeg.size()), .image = jpeg.data()};
+      payload.resize(size_t(lcmtypes_image_t_encoded_size(&msg)));
+      lcmtypes_image_t_encode(payload.data(), 0, int(payload.size()), &msg);
+      channel = "CAM_THUMB";
+    }
+    else if (i % 100 == 0)
+    {
+      lcmtypes_pose_t msg = {.utime = utime, .pos = {double(i) * 0.01, 0, 0}, .orientation = {1, 0, 0, 0}};
+      payload.resize(size_t(lcmtypes_pose_t_encoded_size(&msg)));
+      lcmtypes_pose_t_encode(payload.data(), 0, int(payload.size()), &msg);
+      channel = "POSE";
+    }
+    else if (i % 20 == 0)
+    {
+      lcmtypes_laser_t msg = {.utime = utime, .nranges = int32_t(ranges.size()), .ranges = ranges.data(), .rad0 = -1.57f, .radstep = 0.0174f};
+      payload.resize(size_t(lcmtypes_laser_t_encoded_size(&msg)));
+      lcmtypes_laser_t_encode(payload.data(), 0, int(payload.size()), &msg);
+      channel = "BROOM";
+    }
+    else
+    {
+      uint8_t packet[VELODYNE_PACKET_LEN];
+      make_turning_packet(&azimuth, 20, packet);
+      lcmtypes_velodyne_t msg = {.utime = utime, .datalen = int32_t(VELODYNE_PACKET_LEN), .data = packet};
+      payload.resize(size_t(lcmtypes_velodyne_t_encoded_size(&msg)));
+      lcmtypes_velodyne_t_encode(payload.data(), 0, int(payload.size()), &msg);
+      channel = "VELODYNE";
+    }
+    event.clear();
+    put_event(event, i, uint64_t(utime), channel, payload.data(), payload.size());
+    fwrite(event.data(), 1, event.size(), f);
+  }
+  fclose(f);
+  return path;
+}
+
+struct BenchChannel
+{
+  std::string topic;
+  std::string frame_id;
+  BackfillChannel channel;
+};
+
+int main(int argc, char **argv)
+{
+  std::string path = argc > 1 ? argv[1] : write_backfill_log(200000);
+
+  foxglove_data_loader::Reader log = foxglove_data_loader::Reader::open(path.c_str());
+  LogIndex log_index;
+  {
+    WindowedReader scan_reader(log, SCAN_WINDOW_SIZE);
+    if (scan_log(scan_reader, &log_index) < 0 || log_index.events.empty())
+    {
+      fprintf(stderr, "%s: failed to scan log\n", path.c_str());
+      return 1;
+    }
+  }
+  // the loader's time-sorted index, per-channel positions and POSE index
+  std::vector<EventIndex> index = std::move(log_index.events);
+  std::stable_sort(index.begin(), index.end(), [](const EventIndex &a, const EventIndex &b)
+                   { return a.timestamp_ns < b.timestamp_ns; });
+  std::vector<std::vector<uint32_t>> positions(log_index.channels.size());
+  PoseIndex pose_index;
+  for (size_t i = 0; i < index.size(); i++)
+  {
+    positions[index[i].channel_id].push_back(uint32_t(i));
+    const IndexedChannel &indexed = log_index.channels[index[i].channel_id];
+    if (indexed.topic == POSE_CHANNEL && indexed.fingerprint == __lcmtypes_pose_t_get_hash())
+    {
+      pose_index.utimes.push_back(int64_t(index[i].timestamp_ns / 1000));
+      pose_index.offsets.push_back(index[i].offset);
+    }
+  }
+
+  // the channels the loader advertises for each indexed channel of a known type
+  std::vector<BenchChannel> channels;
+  for (size_t i = 0; i < log_index.channels.size(); i++)
+  {
+    const IndexedChannel &indexed = log_index.channels[i];
+    std::string frame_id = indexed.topic;
+    std::transform(frame_id.begin(), frame_id.end(), frame_id.begin(), ::tolower);
+    auto add = [&](const std::string &suffix, TranscodeFn transcode, bool sweep, bool local, bool decimated)
+    {
+      channels.push_back(BenchChannel{
+          .topic = indexed.topic + suffix,
+          .frame_id = local ? LOCAL_FRAME_ID : frame_id,
+          .channel = BackfillChannel{
+              .events = &positions[i],
+              .transcode = transcode,
+              .sweep = sweep,
+              .local = local,
+              .decimated = decimated,
+          },
+      });
+    };
+    if (indexed.fingerprint == __lcmtypes_image_t_get_hash())
+    {
+      add("", transcode_image, false, false, false);
+    }
+    else if (indexed.fingerprint == __lcmtypes_laser_t_get_hash())
+    {
+      add("", transcode_laser, false, false, false);
+    }
+    else if (indexed.fingerprint == __lcmtypes_pose_t_get_hash())
+    {
+      add("", transcode_pose, false, false, false);
+      channels.back().frame_id = LOCAL_FRAME_ID;
+    }
+    else if (indexed.fingerprint == __lcmtypes_velodyne_t_get_hash())
+    {
+      add("", transcode_velodyne, false, false, false);
+      add("_SWEEP", transcode_velodyne, true, false, false);
+      if (!pose_index.utimes.empty())
+      {
+        add("_LOCAL", transcode_velodyne, false, true, false);
+        add("_SWEEP_LOCAL", transcode_velodyne, true, true, false);
+      }
+      add("/decimated", transcode_velodyne, false, false, true);
+      add("_SWEEP/decimated", transcode_velodyne, true, false, true);
+    }
+  }
+  for (BenchChannel &bench : channels)
+  {
+    bench.channel.frame_id = bench.frame_id.c_str();
+  }
+
+  std::mt19937_64 rng(1);
+  uint64_t start = index.front().timestamp_ns;
+  uint64_t span = index.back().timestamp_ns - start + 1;
+  std::vector<uint64_t> times(BACKFILLS);
+  for (uint64_t &time : times)
+  {
+    time = start + rng() % span;
+  }
+
+  Backfill backfill(&index, log, ITERATOR_WINDOW_SIZE, &pose_index, POSE_WINDOW_SIZE, DownsampleConfig{});
+  std::vector<uint8_t> out;
+  using Clock = std::chrono::steady_clock;
+  // Backfills `channels` at every time, and returns the seconds taken and the messages written.
+  auto run = [&](const std::vector<const BenchChannel *> &selected, size_t *found, size_t *bytes)
+  {
+    *found = 0;
+    *bytes = 0;
+    Clock::time_point begin = Clock::now();
+    for (uint64_t time : times)
+    {
+      for (const BenchChannel *bench : selected)
+      {
+        const EventIndex *stamp = nullptr;
+        int32_t result = backfill.latest_message(bench->channel, time, &out, &stamp);
+        if (result < 0)
+        {
+          fprintf(stderr, "%s: failed to backfill %s at offset %llu\n", path.c_str(), bench->topic.c_str(),
+                  (unsigned long long)stamp->offset);
+          exit(1);
+        }
+        if (result == BACKFILL_FOUND)
+        {
+          (*found)++;
+          *bytes += out.size();
+          keep(out);
+        }
+      }
+    }
+    return std::chrono::duration<double>(Clock::now() - begin).count();
+  };
+
+  printf("%s: %zu events on %zu channels, %zu backfills at random times\n", path.c_str(), index.size(),
+         log_index.channels.size(), BACKFILLS);
+  printf("%-28s %10s %14s %12s\n", "channel", "messages", "per backfill", "bytes");
+  std::vector<const BenchChannel *> all;
+  for (const BenchChannel &bench : channels)
+  {
+    all.push_back(&bench);
+    size_t found;
+    size_t bytes;
+    double seconds = run({&bench}, &found, &bytes);
+    printf("%-28s %10zu %11.1f us %12.0f\n", bench.topic.c_str(), found, seconds * 1e6 / BACKFILLS,
+           double(bytes) / double(std::max<size_t>(found, 1)));
+  }
+  size_t found;
+  size_t bytes;
+  double seconds = run(all, &found, &bytes);
+  printf("%-28s %10zu %11.1f us %12.0f\n", "every channel", found, seconds * 1e6 / BACKFILLS,
+         double(bytes) / double(std::max<size_t>(found, 1)));
+  return 0;
+}
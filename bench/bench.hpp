@@ -0,0 +1,158 @@
+// Helpers shared by the native benchmarks in this directory and the tests in test/.
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+/** Keeps the compiler from discarding the computation of `value`. */
+template <typename T>
+inline void keep(const T &value)
+{
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+/** Calls `fn` until at least `min_seconds` have passed, and returns the mean seconds per call. */
+template <typename Fn>
+double seconds_per_call(Fn &&fn, double min_seconds = 0.5)
+{
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point start = Clock::now();
+  size_t calls = 0;
+  double elapsed = 0;
+  do
+  {
+    fn();
+    calls++;
+    elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+  } while (elapsed < min_seconds);
+  return elapsed / double(calls);
+}
+
+/** A channel of a synthetic log. Event `i` of the log is on the first channel whose `every` divides
+ * `i`, so the last channel should have an `every` of 1. */
+struct SyntheticChannel
+{
+  const char *name;
+  uint32_t every;
+  uint32_t payload_len;
+};
+
+inline void put_be(std::vector<uint8_t> &out, uint64_t v, int bytes)
+{
+  for (int i = bytes - 1; i >= 0; i--)
+  {
+    out.push_back(uint8_t(v >> (8 * i)));
+  }
+}
+
+/** Appends an LCM log event holding `data` on `channel` to `out`. */
+inline void put_event(std::vector<uint8_t> &out, uint64_t event_number, uint64_t timestamp_us, const char *channel,
+                      const uint8_t *data, size_t len)
+{
+  put_be(out, 0xEDA1DA01, 4);
+  put_be(out, event_number, 8);
+  put_be(out, timestamp_us, 8);
+  put_be(out, strlen(channel), 4);
+  put_be(out, len, 4);
+  out.insert(out.end(), channel, channel + strlen(channel));
+  out.insert(out.end(), data, data + len);
+}
+
+/** Writes a log of `count` events 1 ms apart to a file in the temporary directory, and returns its
+ * path. Payloads start with an 8-byte fingerprint made from the channel's position in `channels`. */
+inline std::string write_synthetic_log(const char *name, uint64_t count, const std::vector<SyntheticChannel> &channels)
+{
+  std::string path = (std::filesystem::temp_directory_path() / name).string();
+  FILE *f = fopen(path.c_str(), "wb");
+  if (f == nullptr)
+  {
+    perror(path.c_str());
+    exit(1);
+  }
+  std::vector<uint8_t> event;
+  for (uint64_t i = 0; i < count; i++)
+  {
+    size_t c = 0;
+    while (c + 1 < channels.size() && i % channels[c].every != 0)
+    {
+      c++;
+    }
+    const SyntheticChannel &channel = channels[c];
+    std::vector<uint8_t> payload;
+    put_be(payload, 0x1000 + c, 8);
+    payload.resize(channel.payload_len, uint8_t(i));
+    event.clear();
+    put_event(event, i, 1000000000000 + i * 1000, channel.name, payload.data(), payload.size());
+    fwrite(event.data(), 1, event.size(), f);
+  }
+  fclose(f);
+  return path;
+}
+
+/** Fills `packet` with a Velodyne packet of 12 blocks at random azimuths, alternating between the
+ * upper and lower lasers, with random ranges and intensities. About one return in eight is out of
+ * range. If `corrupt_azimuths`, a few blocks get azimuths past a full turn, as corrupt packets do. */
+inline void make_velodyne_packet(std::mt19937 &rng, bool corrupt_azimuths, uint8_t packet[1206])
+{
+  for (int b = 0; b < 12; b++)
+  {
+    uint8_t *block = packet + b * 100;
+    uint16_t magic = b % 2 == 0 ? 0xeeff : 0xddff;
+    uint16_t azimuth = uint16_t(rng() % 36000);
+    if (corrupt_azimuths && rng() % 16 == 0)
+    {
+      azimuth = uint16_t(36000 + rng() % 29536);
+    }
+    block[0] = uint8_t(magic);
+    block[1] = uint8_t(magic >> 8);
+    block[2] = uint8_t(azimuth);
+    block[3] = uint8_t(azimuth >> 8);
+    for (int i = 0; i < 32; i++)
+    {
+      uint16_t range = rng() % 8 == 0 ? 0 : uint16_t(rng() % 60000);
+      block[4 + i * 3] = uint8_t(range);
+      block[5 + i * 3] = uint8_t(range >> 8);
+      block[6 + i * 3] = uint8_t(rng());
+    }
+  }
+  // revolution count and version string
+  memcpy(packet + 1200, "\x01\x00v1.0", 6);
+}
+
+/** Fills `packet` with the next packet of a head turning steadily by `step` hundredths of a degree
+ * between the firings of the upper lasers, whose azimuth is `*azimuth`. Each upper block is followed
+ * by a lower block at the same azimuth. Ranges follow a fixed pattern over the lasers and blocks,
+ * and one laser in seven has no return. */
+inline void make_turning_packet(uint16_t *azimuth, uint16_t step, uint8_t packet[1206])
+{
+  memset(packet, 0, 1206);
+  for (int b = 0; b < 12; b++)
+  {
+    uint8_t *block = packet + b * 100;
+    bool upper = b % 2 == 1;
+    block[0] = 0xff;
+    block[1] = upper ? 0xee : 0xdd;
+    block[2] = uint8_t(*azimuth);
+    block[3] = uint8_t(*azimuth >> 8);
+    if (upper)
+    {
+      *azimuth = uint16_t((*azimuth + step) % 36000);
+    }
+    for (int i = 0; i < 32; i++)
+    {
+      uint16_t range = i % 7 == 0 ? 0 : uint16_t(1000 + (i * 37 + b * 11) % 5000);
+      block[4 + i * 3] = uint8_t(range);
+      block[5 + i * 3] = uint8_t(range >> 8);
+      block[6 + i * 3] = uint8_t(i * 8);
+    }
+  }
+  memcpy(packet + 1200, "\x01\x00v1.0", 6);
+}
@@ -0,0 +1,65 @@
+// coretypes: ns per call of the big-endian array encoders and decoders in lcm_coretypes.h, which
+// every generated lcmtypes_*_encode and _decode ends in, for each element type and a few array
+// lengths: 16, a laser_t scan of 181 ranges, and 4096.
+#include "bench.hpp"
+#include "lcm/lcm_coretypes.h"
+
+/** Times encoding and decoding `T` arrays of each length with `encode` and `decode`. */
+template <typename T, int (*encode)(void *, int, int, const T *, int), int (*decode)(const void *, int, int, T *, int)>
+void bench_type(const char *name)
+{
+  const int lengths[] = {16, 181, 4096};
+  std::mt19937 rng(1);
+  for (int n : lengths)
+  {
+    std::vector<T> values(n);
+    for (T &v : values)
+    {
+      uint64_t bits = (uint64_t(rng()) << 32) | rng();
+      memcpy(&v, &bits, sizeof(T));
+    }
+    std::vector<uint8_t> buf(n * sizeof(T));
+    std::vector<T> decoded(n);
+    int maxlen = int(buf.size());
+    if (encode(buf.data(), 0, maxlen, values.data(), n) != maxlen ||
+        decode(buf.data(), 0, maxlen, decoded.data(), n) != maxlen ||
+        memcmp(values.data(), decoded.data(), buf.size()) != 0)
+    {
+      fprintf(stderr, "%s arrays of %d do not round-trip\n", name, n);
+      exit(1);
+    }
+    // Each timed call makes `batch` calls, so that short arrays are not lost in reading the clock.
+    const int batch = 64;
+    double encode_seconds = seconds_per_call([&]()
+                                             {
+                                               for (int i = 0; i < batch; i++)
+                                               {
+                                                 encode(buf.data(), 0, maxlen, values.data(), n);
+                                                 keep(buf);
+                                               }
+                                             }) /
+                            batch;
+    double decode_seconds = seconds_per_call([&]()
+                                             {
+                                               for (int i = 0; i < batch; i++)
+                                               {
+                                                 decode(buf.data(), 0, maxlen, decoded.data(), n);
+                                                 keep(decoded);
+                                               }
+                                             }) /
+                            batch;
+    printf("%-8s %6d %11.1f ns %11.1f ns %9.2f GB/s\n", name, n, encode_seconds * 1e9, decode_seconds * 1e9,
+           double(buf.size()) / decode_seconds / 1e9);
+  }
+}
+
+int main()
+{
+  printf("%-8s %6s %14s %14s %14s\n", "type", "length", "encode", "decode", "decode");
+  bench_type<int16_t, __int16_t_encode_array, __int16_t_decode_array>("int16");
+  bench_type<int32_t, __int32_t_encode_array, __int32_t_decode_array>("int32");
+  bench_type<int64_t, __int64_t_encode_array, __int64_t_decode_array>("int64");
+  bench_type<float, __float_encode_array, __float_decode_array>("float");
+  bench_type<double, __double_encode_array, __double_decode_array>("double");
+  return 0;
+}
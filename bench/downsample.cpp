@@ -0,0 +1,143 @@
+// downsample: throughput of the VELODYNE and VELODYNE_SWEEP transcoding paths through each
+// DownsampleMode, in decoded points per second, and the points left in each message, with
+// max_points = 0. Packets come from a head turning steadily at 0.2 degrees per firing, so that
+// sweeps are 300 packets long.
+#include "bench.hpp"
+#include "lcm/lcmtypes_velodyne_t.h"
+#include "transcode.hpp"
+
+constexpr int PACKETS = 20000;
+/** Hundredths of a degree the head turns between the firings of the upper lasers. */
+constexpr uint16_t AZIMUTH_STEP = 20;
+
+struct Pass
+{
+  double seconds = 0;
+  size_t messages = 0;
+  size_t points_out = 0;
+};
+
+/** Transcodes every packet into its own message, as the VELODYNE channels do. */
+Pass transcode_packets(const std::vector<std::vector<uint8_t>> &events, PointDownsampler *downsampler)
+{
+  Transcoder transcoder;
+  PointCloudStages stages{.downsampler = downsampler};
+  std::vector<uint8_t> out;
+  Pass pass;
+  for (const std::vector<uint8_t> &event : events)
+  {
+    VelodyneView vel;
+    if (!view_velodyne(event.data(), event.size(), &vel) ||
+        transcoder.transcode_point_cloud(vel, &out, "velodyne", stages) < 0)
+    {
+      fprintf(stderr, "failed to transcode packet\n");
+      exit(1);
+    }
+    const VelodynePacketPoints &points = transcoder.velodyne_points;
+    pass.points_out += size_t(points.block_start[points.blocks]);
+    pass.messages++;
+    keep(out);
+  }
+  return pass;
+}
+
+/** Assembles the packets into sweeps and transcodes each, as the VELODYNE_SWEEP channels do. */
+Pass transcode_sweeps(const std::vector<std::vector<uint8_t>> &events, PointDownsampler *downsampler)
+{
+  Transcoder transcoder;
+  PointCloudStages stages{.downsampler = downsampler};
+  std::vector<uint8_t> out;
+  VelodyneSweep sweep;
+  size_t stride = point_stride(transcoder.point_layout);
+  int32_t first_block = 0;
+  Pass pass;
+  for (size_t i = 0; i < events.size();)
+  {
+    foxglove_data_loader::BytesView event{.ptr = events[i].data(), .len = events[i].size()};
+    int32_t wrap = transcoder.add_sweep_blocks(event, first_block, &sweep, stages);
+    if (wrap < 0)
+    {
+      fprintf(stderr, "failed to add packet to sweep\n");
+      exit(1);
+    }
+    if (wrap == VELODYNE_BLOCKS_PER_PACKET)
+    {
+      first_block = 0;
+      i++;
+      continue;
+    }
+    first_block = wrap;
+    pass.points_out += sweep.points.size() / stride;
+    pass.messages++;
+    transcoder.encode_sweep(sweep, &out, "velodyne", stages);
+    keep(out);
+    sweep.clear();
+    if (downsampler != nullptr)
+    {
+      downsampler->reset();
+    }
+  }
+  return pass;
+}
+
+/** Runs `pass` until at least half a second has passed, and returns its counts with the mean time. */
+template <typename Fn>
+Pass time_pass(Fn &&pass)
+{
+  Pass result;
+  result.seconds = seconds_per_call([&]()
+                                    { result = pass(); });
+  return result;
+}
+
+int main()
+{
+  std::vector<std::vector<uint8_t>> events(PACKETS);
+  uint16_t azimuth = 0;
+  for (int i = 0; i < PACKETS; i++)
+  {
+    uint8_t packet[VELODYNE_PACKET_LEN];
+    make_turning_packet(&azimuth, AZIMUTH_STEP, packet);
+    lcmtypes_velodyne_t msg = {
+        .utime = 1000000000 + int64_t(i) * 400,
+        .datalen = int32_t(VELODYNE_PACKET_LEN),
+        .data = packet,
+    };
+    events[i].resize(size_t(lcmtypes_velodyne_t_encoded_size(&msg)));
+    lcmtypes_velodyne_t_encode(events[i].data(), 0, int(events[i].size()), &msg);
+  }
+
+  struct Mode
+  {
+    const char *name;
+    bool downsample;
+    DownsampleMode mode;
+  };
+  const Mode modes[] = {
+      {"none", false, DownsampleMode::STRIDE},
+      {"stride", true, DownsampleMode::STRIDE},
+      {"ring", true, DownsampleMode::RING},
+      {"voxel", true, DownsampleMode::VOXEL},
+  };
+  // every mode decodes the points that are left with none
+  Pass decoded = transcode_packets(events, nullptr);
+  printf("%d packets of %.0f points, max_points = 0\n", PACKETS, double(decoded.points_out) / PACKETS);
+  printf("%-8s %20s %16s %20s %16s\n", "mode", "packets", "points/packet", "sweeps", "points/sweep");
+  for (const Mode &mode : modes)
+  {
+    DownsampleConfig config;
+    config.mode = mode.mode;
+    config.max_points = 0;
+    PointDownsampler downsampler(config);
+    PointDownsampler *stage = mode.downsample ? &downsampler : nullptr;
+    Pass packets = time_pass([&]()
+                             { return transcode_packets(events, stage); });
+    Pass sweeps = time_pass([&]()
+                            { return transcode_sweeps(events, stage); });
+    double points_in = double(decoded.points_out);
+    printf("%-8s %11.1f M pts/s %16.0f %11.1f M pts/s %16.0f\n", mode.name, points_in / packets.seconds / 1e6,
+           double(packets.points_out) / double(packets.messages), points_in / sweeps.seconds / 1e6,
+           double(sweeps.points_out) / double(sweeps.messages));
+  }
+  return 0;
+}
@@ -0,0 +1,128 @@
+// jpeg_passthrough: MB/s of JPEGs passed from image_t events into CompressedImage messages by
+// Transcoder::transcode_image, next to a plain memcpy of the same bytes and to the path it
+// replaced, which decoded the whole image_t, copied the JPEG into a CompressedImage and encoded that
+// with the SDK.
+#include "bench.hpp"
+#include "lcm/lcmtypes_image_t.h"
+#include "lcm_views.hpp"
+#include "proto_writer.hpp"
+#include "transcode.hpp"
+
+#include <optional>
+#include <string>
+
+/** The fields of foxglove::schemas::CompressedImage, whose header needs the rest of the SDK. */
+struct CompressedImage
+{
+  struct Timestamp
+  {
+    uint32_t sec;
+    uint32_t nsec;
+  };
+  std::optional<Timestamp> timestamp;
+  std::string frame_id;
+  std::vector<std::byte> data;
+  std::string format;
+};
+
+/** Writes `img` as foxglove.CompressedImage. */
+template <typename Sink>
+void write_image(Sink &sink, const CompressedImage &img)
+{
+  if (img.timestamp)
+  {
+    sink.message_field(1, [&](auto &ts)
+                       {
+                         ts.varint_field(1, img.timestamp->sec);
+                         ts.varint_field(2, img.timestamp->nsec);
+                       });
+  }
+  sink.bytes_field(2, img.data.data(), img.data.size());
+  sink.string_field(3, img.format);
+  sink.string_field(4, img.frame_id);
+}
+
+/** Stands in for the SDK's encoder, which is only built for wasm. It sizes the message and then
+ * writes it into `out`, copying the JPEG once more, as the SDK did through the loader's
+ * encode_to_vec once `out` had grown large enough. */
+void encode_image(const CompressedImage &img, std::vector<uint8_t> *out)
+{
+  ProtoSizer sizer;
+  write_image(sizer, img);
+  out->resize(sizer.size());
+  ProtoWriter writer(out->data());
+  write_image(writer, img);
+}
+
+/** The old Transcoder::transcode_image. */
+void transcode_image_before(const std::vector<uint8_t> &event, std::vector<uint8_t> *out, const char *frame_id)
+{
+  lcmtypes_image_t msg;
+  lcmtypes_image_t_decode(event.data(), 0, int(event.size()), &msg);
+  CompressedImage img;
+  uint32_t usec = uint32_t(msg.utime);
+  img.timestamp.emplace(CompressedImage::Timestamp{.sec = usec / 1000000, .nsec = (usec % 1000000) * 1000});
+  img.frame_id = frame_id;
+  const std::byte *ptr = reinterpret_cast<const std::byte *>(msg.image);
+  img.data.insert(img.data.end(), ptr, ptr + msg.size);
+  img.format = "jpeg";
+  encode_image(img, out);
+  lcmtypes_image_t_decode_cleanup(&msg);
+}
+
+int main()
+{
+  const size_t sizes[] = {16 * 1024, 256 * 1024, 4 * 1024 * 1024};
+  Transcoder transcoder;
+  std::vector<uint8_t> out;
+  printf("%10s %14s %14s %14s\n", "JPEG (KB)", "memcpy", "transcode", "before");
+  for (size_t size : sizes)
+  {
+    std::vector<uint8_t> jpeg(size);
+    std::mt19937 rng(1);
+    for (uint8_t &byte : jpeg)
+    {
+      byte = uint8_t(rng());
+    }
+    lcmtypes_image_t msg = {
+        // within 32 bits, which the old path truncated utimes to
+        .utime = 4000000000,
+        .width = 376,
+        .height = 240,
+        .stride = 0,
+        .pixelformat = 0,
+        .size = int32_t(size),
+        .image = jpeg.data(),
+    };
+    std::vector<uint8_t> event(size_t(lcmtypes_image_t_encoded_size(&msg)));
+    lcmtypes_image_t_encode(event.data(), 0, int(event.size()), &msg);
+
+    std::vector<uint8_t> copy(size);
+    double memcpy_seconds = seconds_per_call([&]()
+                                             { memcpy(copy.data(), jpeg.data(), size); keep(copy); });
+    auto transcode = [&]()
+    {
+      ImageView image;
+      if (!view_image(event.data(), event.size(), &image) || transcoder.transcode_image(image, &out, "cam_thumb") < 0)
+      {
+        fprintf(stderr, "failed to transcode image\n");
+        exit(1);
+      }
+      keep(out);
+    };
+    double transcode_seconds = seconds_per_call(transcode);
+    std::vector<uint8_t> before;
+    transcode_image_before(event, &before, "cam_thumb");
+    if (before != out)
+    {
+      fprintf(stderr, "transcode_image and the path it replaced disagree\n");
+      exit(1);
+    }
+    double before_seconds = seconds_per_call([&]()
+                                             { transcode_image_before(event, &before, "cam_thumb"); keep(before); });
+    double mb = double(size) / 1e6;
+    printf("%10zu %9.0f MB/s %9.0f MB/s %9.0f MB/s\n", size / 1024, mb / memcpy_seconds, mb / transcode_seconds,
+           mb / before_seconds);
+  }
+  return 0;
+}
@@ -0,0 +1,103 @@
+// scan: times scan_log, which builds the index when a log is opened without one, and the lookup of
+// each event's channel within it: the ChannelTable it uses, next to the linear search over the
+// channels seen so far that it replaced. The baseline scan is the scan with the difference between
+// the two lookups added back.
+//
+// usage: scan [log]
+//
+// Without a log, a synthetic one of 1,000,000 events on 20 channels is written to the temporary
+// directory.
+#include "bench.hpp"
+#include "channel_table.hpp"
+#include "log_index.hpp"
+
+/** As in the loader. */
+constexpr size_t SCAN_WINDOW_SIZE = 4 * 1024 * 1024;
+
+/** The channel lookup scan_log did before ChannelTable: a compare against every channel seen. */
+int32_t find_linear(const std::vector<IndexedChannel> &channels, std::string_view name, int64_t fingerprint)
+{
+  for (size_t i = 0; i < channels.size(); i++)
+  {
+    if (channels[i].topic == name && channels[i].fingerprint == fingerprint)
+    {
+      return int32_t(i);
+    }
+  }
+  return -1;
+}
+
+int main(int argc, char **argv)
+{
+  std::string path;
+  if (argc > 1)
+  {
+    path = argv[1];
+  }
+  else
+  {
+    // many small events on channels with similar names, where interning the names matters most
+    static const char *names[] = {
+        "VELODYNE", "POSE", "BROOM_L", "BROOM_R", "BROOM_C", "BROOM_CL", "BROOM_CR",
+        "SKIRT_FL", "SKIRT_FR", "SKIRT_RL", "SKIRT_RR", "CAM_THUMB_RFC", "CAM_THUMB_RFL",
+        "CAM_THUMB_RFR", "CAM_THUMB_RNL", "CAM_THUMB_RNR", "GPS_TO_LOCAL", "IMU", "ODOMETRY", "STATUS"};
+    std::vector<SyntheticChannel> channels;
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+    {
+      channels.push_back({names[i], uint32_t(20 - i), 64});
+    }
+    path = write_synthetic_log("lcm-bench-scan.lcm", 1000000, channels);
+  }
+
+  LogIndex index;
+  uint64_t file_size = 0;
+  auto scan = [&]()
+  {
+    WindowedReader reader(foxglove_data_loader::Reader::open(path.c_str()), SCAN_WINDOW_SIZE);
+    index = LogIndex();
+    if (scan_log(reader, &index) < 0)
+    {
+      fprintf(stderr, "%s: failed to scan log\n", path.c_str());
+      exit(1);
+    }
+    file_size = reader.size();
+  };
+  double seconds = seconds_per_call(scan, 2.0);
+
+  // Each event's channel name, in copies apart from the strings they are compared with, as the
+  // names in the scan window are.
+  std::vector<std::string> names;
+  ChannelTable table;
+  for (const IndexedChannel &channel : index.channels)
+  {
+    names.push_back(channel.topic);
+    table.insert(channel.topic, channel.fingerprint);
+  }
+  size_t events = index.events.size();
+  int64_t found = 0;
+  auto lookup = [&](auto &&find)
+  {
+    return seconds_per_call([&]()
+                            {
+                              for (const EventIndex &event : index.events)
+                              {
+                                found += find(names[event.channel_id], index.channels[event.channel_id].fingerprint);
+                              }
+                              keep(found);
+                            });
+  };
+  double table_seconds = lookup([&](std::string_view name, int64_t fingerprint)
+                                { return table.find(name, fingerprint); });
+  double linear_seconds = lookup([&](std::string_view name, int64_t fingerprint)
+                                 { return find_linear(index.channels, name, fingerprint); });
+  double baseline_seconds = seconds + linear_seconds - table_seconds;
+
+  printf("%s: %zu events on %zu channels, %.1f MB\n", path.c_str(), events, index.channels.size(),
+         double(file_size) / 1e6);
+  printf("%-18s %12s %16s %10s\n", "", "scan", "events", "lookup");
+  printf("%-18s %9.1f ms %9.2f M/s %7.1f ns\n", "ChannelTable", seconds * 1e3, double(events) / seconds / 1e6,
+         table_seconds * 1e9 / double(events));
+  printf("%-18s %9.1f ms %9.2f M/s %7.1f ns\n", "linear (baseline)", baseline_seconds * 1e3,
+         double(events) / baseline_seconds / 1e6, linear_seconds * 1e9 / double(events));
+  return 0;
+}
@@ -0,0 +1,62 @@
+// seek: times the binary search that positions message iterators at their start time, over indexes
+// of 1e4 to 1e8 events.
+//
+// usage: seek [max events]
+#include "bench.hpp"
+#include "log_index.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+/** Seeks per timed call, so that reading the clock does not dominate. */
+constexpr size_t SEEKS_PER_CALL = 1024;
+
+/** Channels that the events are spread over, round robin. The seek is timed on the first. */
+constexpr uint16_t CHANNELS = 4;
+
+int main(int argc, char **argv)
+{
+  uint64_t max_events = argc > 1 ? strtoull(argv[1], nullptr, 10) : 100000000;
+  std::mt19937_64 rng(1);
+  printf("%12s %12s %12s\n", "events", "ns/seek", "Mseeks/s");
+  for (uint64_t count = 10000; count <= max_events; count *= 10)
+  {
+    // events 1 ms apart, on a channel of a quarter of them
+    std::vector<EventIndex> events(count);
+    std::vector<uint32_t> positions;
+    positions.reserve(count / CHANNELS + 1);
+    for (uint64_t i = 0; i < count; i++)
+    {
+      events[i] = EventIndex{
+          .offset = i * 256,
+          .channel_id = uint16_t(i % CHANNELS),
+          .schema_id = 0,
+          .timestamp_ns = i * 1000000,
+      };
+      if (events[i].channel_id == 0)
+      {
+        positions.push_back(uint32_t(i));
+      }
+    }
+    std::vector<uint64_t> times(SEEKS_PER_CALL);
+    for (uint64_t &time : times)
+    {
+      time = rng() % (count * 1000000);
+    }
+
+    auto seek_all = [&]()
+    {
+      size_t sum = 0;
+      for (uint64_t time : times)
+      {
+        sum += events_lower_bound(events, positions, time);
+      }
+      keep(sum);
+    };
+    double seconds = seconds_per_call(seek_all);
+    double ns_per_seek = seconds * 1e9 / SEEKS_PER_CALL;
+    printf("%12llu %12.1f %12.2f\n", (unsigned long long)count, ns_per_seek, 1e3 / ns_per_seek);
+  }
+  return 0;
+}
@@ -0,0 +1,76 @@
+// velodyne_decode: points per second decoded by velodyne_decode_packet in each VelodyneTableMode,
+// and by the stock velodyne_decoder_next that it replaced, from synthetic packets. Also times
+// building the tables of each mode.
+#include "bench.hpp"
+#include "velodyne_batch.hpp"
+
+/** As in the transcoder. */
+constexpr double VELODYNE_MIN_RANGE = 0.01;
+
+constexpr int PACKETS = 1000;
+
+int main()
+{
+  velodyne_calib_t *calib = velodyne_calib_create();
+  std::vector<uint8_t> packets(PACKETS * VELODYNE_PACKET_LEN);
+  std::mt19937 rng(1);
+  for (int i = 0; i < PACKETS; i++)
+  {
+    make_velodyne_packet(rng, false, &packets[i * VELODYNE_PACKET_LEN]);
+  }
+
+  size_t points = 0;
+  auto decode_next = [&]()
+  {
+    points = 0;
+    velodyne_sample_t sample;
+    double sum = 0;
+    for (int i = 0; i < PACKETS; i++)
+    {
+      velodyne_decoder_t decoder;
+      velodyne_decoder_init(calib, &decoder, &packets[i * VELODYNE_PACKET_LEN], int(VELODYNE_PACKET_LEN));
+      while (velodyne_decoder_next(calib, &decoder, &sample) == 0)
+      {
+        if (sample.range < VELODYNE_MIN_RANGE)
+        {
+          continue;
+        }
+        sum += sample.xyz[0];
+        points++;
+      }
+    }
+    keep(sum);
+  };
+  double seconds = seconds_per_call(decode_next);
+  printf("%-32s %8.1f M points/s\n", "velodyne_decoder_next", double(points) / seconds / 1e6);
+
+  const std::pair<VelodyneTableMode, const char *> modes[] = {
+      {VelodyneTableMode::NONE, "none"},
+      {VelodyneTableMode::AZIMUTH, "azimuth"},
+      {VelodyneTableMode::FULL, "full"},
+  };
+  static VelodynePacketPoints decoded;
+  for (auto [mode, name] : modes)
+  {
+    VelodyneLaserTable table;
+    double build_seconds = seconds_per_call([&]()
+                                            { build_laser_table(calib, mode, &table); });
+    auto decode_packet = [&]()
+    {
+      points = 0;
+      for (int i = 0; i < PACKETS; i++)
+      {
+        points += size_t(velodyne_decode_packet(table, &packets[i * VELODYNE_PACKET_LEN], VELODYNE_PACKET_LEN,
+                                                VELODYNE_MIN_RANGE, &decoded));
+        keep(decoded);
+      }
+    };
+    seconds = seconds_per_call(decode_packet);
+    size_t table_bytes = sizeof(table) + table.azimuth_sincos.size() * sizeof(double) + table.directions.size() * sizeof(float);
+    std::string label = std::string("velodyne_decode_packet (") + name + ")";
+    printf("%-32s %8.1f M points/s, table %.2f MB built in %.2f ms\n", label.c_str(), double(points) / seconds / 1e6,
+           double(table_bytes) / 1e6, build_seconds * 1e3);
+  }
+  free(calib);
+  return 0;
+}
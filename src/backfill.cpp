@@ -0,0 +1,115 @@
+#include "backfill.hpp"
+
+#include <algorithm>
+
+bool find_previous_sweep_wrap(WindowedReader &reader, const std::vector<EventIndex> &index,
+                              const std::vector<uint32_t> &positions, SweepBoundary before, SweepBoundary *wrap)
+{
+    size_t lowest = before.packet > size_t(VELODYNE_MAX_SWEEP_PACKETS) ? before.packet - VELODYNE_MAX_SWEEP_PACKETS : 0;
+    // Walk backward over packets, looking for a block whose azimuth is more than half a turn below
+    // the one after it. `following` is the azimuth of the first block of the packet after the one
+    // being examined, if that block is before `before`.
+    int32_t following = -1;
+    int32_t azimuths[VELODYNE_BLOCKS_PER_PACKET];
+    LCMEvent event;
+    for (size_t packet = std::min(before.packet + 1, positions.size()); packet-- > lowest;)
+    {
+        int32_t blocks = -1;
+        if (read_event_at(reader, index[positions[packet]].offset, &event) >= 0)
+        {
+            blocks = velodyne_block_azimuths(event.data, azimuths);
+        }
+        if (blocks <= 0)
+        {
+            following = -1;
+            continue;
+        }
+        if (velodyne_wrapped(azimuths[blocks - 1], following))
+        {
+            *wrap = SweepBoundary{.packet = packet + 1, .block = 0};
+            return true;
+        }
+        int32_t end = packet == before.packet ? std::min(before.block, blocks) : blocks;
+        for (int32_t block = end - 1; block > 0; block--)
+        {
+            if (velodyne_wrapped(azimuths[block - 1], azimuths[block]))
+            {
+                *wrap = SweepBoundary{.packet = packet, .block = block};
+                return true;
+            }
+        }
+        following = packet < before.packet || before.block > 0 ? azimuths[0] : -1;
+    }
+    *wrap = SweepBoundary{.packet = lowest, .block = 0};
+    return false;
+}
+
+Backfill::Backfill(const std::vector<EventIndex> *index, foxglove_data_loader::Reader log, size_t window_size,
+                   const PoseIndex *pose_index, size_t pose_window_size, const DownsampleConfig &downsample_config)
+    : index(index), log(log), pose_index(pose_index), pose_window_size(pose_window_size),
+      downsample_config(downsample_config), reader(log, window_size)
+{
+}
+
+int32_t Backfill::latest_message(const BackfillChannel &channel, uint64_t time_ns, std::vector<uint8_t> *out,
+                                 const EventIndex **stamp)
+{
+    if (channel.local && !poses)
+    {
+        poses = std::make_unique<PoseTrack>(pose_index, log, pose_window_size);
+    }
+    if (channel.decimated && !downsampler)
+    {
+        downsampler = std::make_unique<PointDownsampler>(downsample_config);
+    }
+    PointCloudStages stages{
+        .poses = channel.local ? poses.get() : nullptr,
+        .downsampler = channel.decimated ? downsampler.get() : nullptr,
+    };
+    const std::vector<uint32_t> &positions = *channel.events;
+    size_t end = events_upper_bound(*index, positions, time_ns);
+    if (end == 0)
+    {
+        return BACKFILL_NONE;
+    }
+    if (!channel.sweep)
+    {
+        *stamp = &(*index)[positions[end - 1]];
+        if (read_event_at(reader, (*stamp)->offset, &event) < 0)
+        {
+            return BACKFILL_UNREADABLE;
+        }
+        if (channel.transcode(transcoder, event.data, channel.frame_id, stages, out) < 0)
+        {
+            return BACKFILL_MALFORMED;
+        }
+        return BACKFILL_FOUND;
+    }
+    // the latest sweep that ended at or before `time_ns`
+    SweepBoundary sweep_start;
+    SweepBoundary sweep_end;
+    SweepBoundary last = {.packet = end - 1, .block = VELODYNE_BLOCKS_PER_PACKET};
+    if (!find_previous_sweep_wrap(reader, *index, positions, last, &sweep_end))
+    {
+        return BACKFILL_NONE;
+    }
+    find_previous_sweep_wrap(reader, *index, positions, sweep_end, &sweep_start);
+    sweep.clear();
+    if (stages.downsampler != nullptr)
+    {
+        stages.downsampler->reset();
+    }
+    for (size_t packet = sweep_start.packet; packet <= sweep_end.packet; packet++)
+    {
+        *stamp = &(*index)[positions[packet]];
+        if (read_event_at(reader, (*stamp)->offset, &event) < 0)
+        {
+            return BACKFILL_UNREADABLE;
+        }
+        int32_t first_block = packet == sweep_start.packet ? sweep_start.block : 0;
+        transcoder.add_sweep_blocks(event.data, first_block, &sweep, stages);
+    }
+    transcoder.encode_sweep(sweep, out, channel.frame_id, stages);
+    *stamp = &(*index)[positions[sweep_end.packet]];
+    return BACKFILL_FOUND;
+}
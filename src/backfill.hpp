@@ -0,0 +1,79 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "downsample.hpp"
+#include "log_index.hpp"
+#include "pose_track.hpp"
+#include "transcoder_registry.hpp"
+
+/** Block `block` of the Velodyne packet at position `packet` in a Velodyne channel's events. */
+struct SweepBoundary
+{
+    size_t packet;
+    int32_t block;
+};
+
+/** Returns the position in `positions`, the positions in `index` of a Velodyne channel's events,
+ * and block of the last boundary between sweeps before `before`, looking back at most
+ * VELODYNE_MAX_SWEEP_PACKETS packets. If there is none, returns false and sets `wrap` to the start
+ * of the earliest packet examined.
+ */
+bool find_previous_sweep_wrap(WindowedReader &reader, const std::vector<EventIndex> &index,
+                              const std::vector<uint32_t> &positions, SweepBoundary before, SweepBoundary *wrap);
+
+/** How the messages of a channel are built, as far as backfilling it is concerned. */
+struct BackfillChannel
+{
+    /** Positions in the index of the events that messages are built from, in order of time. */
+    const std::vector<uint32_t> *events;
+    TranscodeFn transcode;
+    bool sweep;
+    bool local;
+    bool decimated;
+    const char *frame_id;
+};
+
+/** Returned by Backfill::latest_message. */
+constexpr int32_t BACKFILL_NONE = 0;
+constexpr int32_t BACKFILL_FOUND = 1;
+constexpr int32_t BACKFILL_UNREADABLE = -1;
+constexpr int32_t BACKFILL_MALFORMED = -2;
+
+/** Finds and transcodes the latest message at or before a time on a channel, as get_backfill does
+ * for each channel it is asked for. The reader, transcoder and buffers are kept between calls, and
+ * the PoseTrack and PointDownsampler are created the first time a channel needs them.
+ */
+class Backfill
+{
+    const std::vector<EventIndex> *index;
+    foxglove_data_loader::Reader log;
+    const PoseIndex *pose_index;
+    size_t pose_window_size;
+    DownsampleConfig downsample_config;
+    WindowedReader reader;
+    LCMEvent event;
+    VelodyneSweep sweep;
+    std::unique_ptr<PoseTrack> poses;
+    std::unique_ptr<PointDownsampler> downsampler;
+
+public:
+    /** Configured by the caller with the calibration and point cloud settings of the log. */
+    Transcoder transcoder;
+
+    /** Reads events in `index`, which is sorted by time, from `log` through a window of
+     * `window_size` bytes, and poses through one of `pose_window_size`. */
+    Backfill(const std::vector<EventIndex> *index, foxglove_data_loader::Reader log, size_t window_size,
+             const PoseIndex *pose_index, size_t pose_window_size, const DownsampleConfig &downsample_config);
+
+    /** Writes the latest message at or before `time_ns` on `channel` into `out`, found with a binary
+     * search over its events: for sweep channels, the latest sweep that ended by then. Only the
+     * events of that message are read. Returns BACKFILL_FOUND and sets `stamp` to the event the
+     * message is stamped with, or BACKFILL_NONE if there is no such message. Returns
+     * BACKFILL_UNREADABLE or BACKFILL_MALFORMED, and sets `stamp` to the event, if an event cannot be
+     * read or transcoded.
+     */
+    int32_t latest_message(const BackfillChannel &channel, uint64_t time_ns, std::vector<uint8_t> *out,
+                           const EventIndex **stamp);
+};
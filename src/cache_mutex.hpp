@@ -0,0 +1,28 @@
+#pragma once
+
+#if defined(__wasi__) && !defined(_REENTRANT)
+/** Guards a process-wide cache. The WASI build is single-threaded and its libc++ has no std::mutex,
+ * so there this does nothing. */
+struct CacheMutex
+{
+    void lock() {}
+    void unlock() {}
+};
+#else
+#include <mutex>
+/** Guards a process-wide cache, such as the shared Velodyne tables, from concurrent loaders. */
+using CacheMutex = std::mutex;
+#endif
+
+/** Holds a CacheMutex for as long as it is in scope. */
+class CacheLock
+{
+    CacheMutex &mutex;
+
+public:
+    explicit CacheLock(CacheMutex &mutex_) : mutex(mutex_) { mutex.lock(); }
+    ~CacheLock() { mutex.unlock(); }
+
+    CacheLock(const CacheLock &) = delete;
+    CacheLock &operator=(const CacheLock &) = delete;
+};
@@ -0,0 +1,80 @@
+#include "channel_table.hpp"
+
+uint64_t fnv1a(uint64_t hash, const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+uint64_t hash_channel(std::string_view name, int64_t fingerprint)
+{
+    // fingerprints are already hashes, so they are mixed in without another pass of FNV
+    return fnv1a(FNV1A_OFFSET_BASIS, reinterpret_cast<const uint8_t *>(name.data()), name.size()) ^ uint64_t(fingerprint);
+}
+
+ChannelTable::ChannelTable() : slots(16, Slot{.hash = 0, .id = EMPTY})
+{
+}
+
+int32_t ChannelTable::find(std::string_view name, int64_t fingerprint) const
+{
+    uint64_t hash = hash_channel(name, fingerprint);
+    size_t mask = slots.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask)
+    {
+        const Slot &slot = slots[i];
+        if (slot.id == EMPTY)
+        {
+            return -1;
+        }
+        if (slot.hash == hash && fingerprints[slot.id] == fingerprint && names[slot.id] == name)
+        {
+            return int32_t(slot.id);
+        }
+    }
+}
+
+uint32_t ChannelTable::insert(std::string_view name, int64_t fingerprint)
+{
+    // keep the load factor at or below 1/2 so probe sequences stay short
+    if ((names.size() + 1) * 2 > slots.size())
+    {
+        grow();
+    }
+    uint32_t id = uint32_t(names.size());
+    names.emplace_back(name);
+    fingerprints.push_back(fingerprint);
+    uint64_t hash = hash_channel(name, fingerprint);
+    size_t mask = slots.size() - 1;
+    size_t i = hash & mask;
+    while (slots[i].id != EMPTY)
+    {
+        i = (i + 1) & mask;
+    }
+    slots[i] = Slot{.hash = hash, .id = id};
+    return id;
+}
+
+void ChannelTable::grow()
+{
+    std::vector<Slot> old = std::move(slots);
+    slots.assign(old.size() * 2, Slot{.hash = 0, .id = EMPTY});
+    size_t mask = slots.size() - 1;
+    for (const Slot &slot : old)
+    {
+        if (slot.id == EMPTY)
+        {
+            continue;
+        }
+        size_t i = slot.hash & mask;
+        while (slots[i].id != EMPTY)
+        {
+            i = (i + 1) & mask;
+        }
+        slots[i] = slot;
+    }
+}
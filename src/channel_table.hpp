@@ -0,0 +1,42 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+
+/** 64-bit FNV-1a over `len` bytes, continuing from `hash`. */
+uint64_t fnv1a(uint64_t hash, const uint8_t *data, size_t len);
+
+constexpr uint64_t FNV1A_OFFSET_BASIS = 0xcbf29ce484222325ULL;
+
+/** Interns channels as dense ids. A channel is a name and the LCM fingerprint of the events on it,
+ * so a name that carries two types becomes two channels. They are looked up by the name's raw bytes
+ * and the fingerprint with one hash probe sequence in an open-addressing table, so resolving an
+ * already-seen channel does not allocate.
+ */
+class ChannelTable
+{
+    struct Slot
+    {
+        uint64_t hash;
+        /** Id of the channel in this slot, or EMPTY. */
+        uint32_t id;
+    };
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    std::vector<Slot> slots;
+    std::vector<std::string> names;
+    std::vector<int64_t> fingerprints;
+
+    void grow();
+
+public:
+    ChannelTable();
+
+    /** Returns the id of `name` carrying `fingerprint`, or -1 if it has not been inserted. */
+    int32_t find(std::string_view name, int64_t fingerprint) const;
+
+    /** Adds a channel that is not already in the table and returns its id. */
+    uint32_t insert(std::string_view name, int64_t fingerprint);
+
+    size_t size() const { return names.size(); }
+};
@@ -0,0 +1,203 @@
+#include "downsample.hpp"
+#include "velodyne_calib.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+/** Slots in the voxel set before it first grows. */
+constexpr size_t INITIAL_VOXEL_SLOTS = 4096;
+
+/** Bits of each voxel coordinate in a voxel key. With 0.2 m leaves, keys are unique within 200 km
+ * of the origin. */
+constexpr int VOXEL_COORD_BITS = 21;
+
+bool load_downsample_config(const uint8_t *buf, size_t len, const std::string &path, DownsampleConfig *out,
+                            std::string *error)
+{
+    Config *config = parse_config(buf, len, path, error);
+    if (config == nullptr)
+    {
+        return false;
+    }
+    DownsampleConfig result = *out;
+    char *mode = nullptr;
+    bool ok = true;
+    if (config_get_str(config, "downsample.mode", &mode) == 0)
+    {
+        if (strcmp(mode, "stride") == 0)
+        {
+            result.mode = DownsampleMode::STRIDE;
+        }
+        else if (strcmp(mode, "ring") == 0)
+        {
+            result.mode = DownsampleMode::RING;
+        }
+        else if (strcmp(mode, "voxel") == 0)
+        {
+            result.mode = DownsampleMode::VOXEL;
+        }
+        else
+        {
+            *error = std::string("unknown downsample.mode ") + mode;
+            ok = false;
+        }
+    }
+    result.stride = config_get_int_or_default(config, "downsample.stride", result.stride);
+    result.ring_step = config_get_int_or_default(config, "downsample.ring_step", result.ring_step);
+    result.leaf_size = config_get_double_or_default(config, "downsample.leaf_size", result.leaf_size);
+    result.max_points = config_get_int_or_default(config, "downsample.max_points", result.max_points);
+    config_free(config);
+    if (ok && (result.stride < 1 || result.ring_step < 1 || !(result.leaf_size > 0) || result.max_points < 0))
+    {
+        *error = "downsample.stride and ring_step must be at least 1, leaf_size positive and max_points not negative";
+        ok = false;
+    }
+    if (ok)
+    {
+        *out = result;
+    }
+    return ok;
+}
+
+PointDownsampler::PointDownsampler(const DownsampleConfig &config) : config(config)
+{
+    if (config.mode == DownsampleMode::VOXEL)
+    {
+        voxel_keys.resize(INITIAL_VOXEL_SLOTS);
+        voxel_generations.assign(INITIAL_VOXEL_SLOTS, 0);
+    }
+}
+
+void PointDownsampler::reset()
+{
+    offered = 0;
+    voxel_count = 0;
+    if (++generation == 0)
+    {
+        // after four billion messages, the generations left in the slots become ambiguous
+        std::fill(voxel_generations.begin(), voxel_generations.end(), 0);
+        generation = 1;
+    }
+}
+
+size_t voxel_slot(uint64_t key, size_t mask)
+{
+    // Fibonacci hashing spreads the packed coordinates over the high bits.
+    return size_t((key * 0x9e3779b97f4a7c15ULL) >> 32) & mask;
+}
+
+/** Returns true if `key` was not yet in the set. */
+bool PointDownsampler::insert_voxel(uint64_t key)
+{
+    size_t mask = voxel_keys.size() - 1;
+    for (size_t slot = voxel_slot(key, mask);; slot = (slot + 1) & mask)
+    {
+        if (voxel_generations[slot] != generation)
+        {
+            voxel_keys[slot] = key;
+            voxel_generations[slot] = generation;
+            if (++voxel_count * 2 > voxel_keys.size())
+            {
+                grow_voxels();
+            }
+            return true;
+        }
+        if (voxel_keys[slot] == key)
+        {
+            return false;
+        }
+    }
+}
+
+void PointDownsampler::grow_voxels()
+{
+    std::vector<uint64_t> keys(voxel_keys.size() * 2);
+    std::vector<uint32_t> generations(voxel_keys.size() * 2, 0);
+    size_t mask = keys.size() - 1;
+    for (size_t i = 0; i < voxel_keys.size(); i++)
+    {
+        if (voxel_generations[i] != generation)
+        {
+            continue;
+        }
+        size_t slot = voxel_slot(voxel_keys[i], mask);
+        while (generations[slot] == generation)
+        {
+            slot = (slot + 1) & mask;
+        }
+        keys[slot] = voxel_keys[i];
+        generations[slot] = generation;
+    }
+    voxel_keys.swap(keys);
+    voxel_generations.swap(generations);
+}
+
+void PointDownsampler::filter(VelodynePacketPoints *points, int32_t first_block, int32_t end_block)
+{
+    const uint64_t coord_mask = (uint64_t(1) << VOXEL_COORD_BITS) - 1;
+    double inverse_leaf = 1.0 / config.leaf_size;
+    int32_t count = points->block_start[first_block];
+    for (int32_t block = first_block; block < end_block; block++)
+    {
+        int32_t begin = points->block_start[block];
+        int32_t end = points->block_start[block + 1];
+        points->block_start[block] = count;
+        for (int32_t i = begin; i < end; i++)
+        {
+            bool keep;
+            switch (config.mode)
+            {
+            case DownsampleMode::STRIDE:
+                keep = offered++ % uint64_t(config.stride) == 0;
+                break;
+            case DownsampleMode::RING:
+                keep = points->ring[i] % config.ring_step == 0;
+                break;
+            case DownsampleMode::VOXEL:
+            default:
+            {
+                uint64_t vx = uint64_t(int64_t(std::floor(points->x[i] * inverse_leaf))) & coord_mask;
+                uint64_t vy = uint64_t(int64_t(std::floor(points->y[i] * inverse_leaf))) & coord_mask;
+                uint64_t vz = uint64_t(int64_t(std::floor(points->z[i] * inverse_leaf))) & coord_mask;
+                keep = insert_voxel((vx << (2 * VOXEL_COORD_BITS)) | (vy << VOXEL_COORD_BITS) | vz);
+                break;
+            }
+            }
+            points->x[count] = points->x[i];
+            points->y[count] = points->y[i];
+            points->z[count] = points->z[i];
+            points->intensity[count] = points->intensity[i];
+            points->ring[count] = points->ring[i];
+            count += keep;
+        }
+    }
+    for (int32_t block = end_block; block <= points->blocks; block++)
+    {
+        points->block_start[block] = count;
+    }
+}
+
+size_t points_within_budget(size_t count, int32_t max_points)
+{
+    return max_points > 0 ? std::min(count, size_t(max_points)) : count;
+}
+
+size_t copy_within_budget(const uint8_t *in, size_t count, size_t stride, int32_t max_points, uint8_t *out)
+{
+    size_t kept = points_within_budget(count, max_points);
+    if (kept == count)
+    {
+        if (count > 0)
+        {
+            memcpy(out, in, count * stride);
+        }
+        return count;
+    }
+    // the k-th point kept is the floor(k * count / kept)-th, spreading them over the whole message
+    for (size_t k = 0; k < kept; k++)
+    {
+        memcpy(out + k * stride, in + size_t(uint64_t(k) * count / kept) * stride, stride);
+    }
+    return kept;
+}
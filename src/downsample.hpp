@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "velodyne_batch.hpp"
+
+enum class DownsampleMode
+{
+    /** Every `stride`th point. */
+    STRIDE,
+    /** The points of every `ring_step`th logical laser. */
+    RING,
+    /** The first point in each cube of side `leaf_size`. */
+    VOXEL,
+};
+
+struct DownsampleConfig
+{
+    DownsampleMode mode = DownsampleMode::VOXEL;
+    int32_t stride = 4;
+    int32_t ring_step = 4;
+    /** Meters. */
+    double leaf_size = 0.2;
+    /** Most points in a message; messages with more are thinned evenly to fit. 0 for no limit. */
+    int32_t max_points = 50000;
+};
+
+/** Reads `downsample.{mode,stride,ring_step,leaf_size,max_points}` from a file in the format of
+ * lcm/config.c, keeping the defaults for keys that are absent. `mode` is one of "stride", "ring"
+ * or "voxel". Returns false and sets `error` if the file cannot be parsed or a value is invalid.
+ */
+bool load_downsample_config(const uint8_t *buf, size_t len, const std::string &path, DownsampleConfig *config,
+                            std::string *error);
+
+/** Drops points from decoded Velodyne packets on their way into one message.
+ *
+ * The voxel filter keeps a flat open-addressing set of the voxels seen in the message so far. The
+ * set is cleared between messages by bumping a generation number rather than by freeing or zeroing
+ * it, so once it has grown to fit the largest message, filtering does not allocate.
+ */
+class PointDownsampler
+{
+    DownsampleConfig config;
+    /** Points offered since the start of the message, for STRIDE. */
+    uint64_t offered = 0;
+
+    /** Voxel keys, valid where the slot's generation is the current one. */
+    std::vector<uint64_t> voxel_keys;
+    std::vector<uint32_t> voxel_generations;
+    uint32_t generation = 1;
+    size_t voxel_count = 0;
+
+    bool insert_voxel(uint64_t key);
+    void grow_voxels();
+
+public:
+    explicit PointDownsampler(const DownsampleConfig &config);
+
+    const DownsampleConfig &settings() const { return config; }
+
+    /** Starts a new message. */
+    void reset();
+
+    /** Drops points from blocks [first_block, end_block) of `points` in place, moving the points
+     * that are kept to the front of each block's range and updating `block_start`. Blocks outside
+     * that range are left empty. */
+    void filter(VelodynePacketPoints *points, int32_t first_block, int32_t end_block);
+};
+
+/** Copies `count` points of `stride` bytes from `in` to `out`, thinned evenly to at most
+ * `max_points` if that is positive. Returns the number of points copied. */
+size_t copy_within_budget(const uint8_t *in, size_t count, size_t stride, int32_t max_points, uint8_t *out);
+
+/** The number of points copy_within_budget would copy. */
+size_t points_within_budget(size_t count, int32_t max_points);
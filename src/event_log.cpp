@@ -1,6 +1,15 @@
-
 #include "event_log.hpp"
 
+#include <algorithm>
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 const uint32_t SYNC_WORD = 0xEDA1DA01;
 
 uint32_t decode_u32(const uint8_t *data)
@@ -13,13 +22,62 @@ uint64_t decode_u64(const uint8_t *data)
     return uint64_t(data[7]) + (uint64_t(data[6]) << 8) + (uint64_t(data[5]) << 16) + (uint64_t(data[4]) << 24) + (uint64_t(data[3]) << 32) + (uint64_t(data[2]) << 40) + (uint64_t(data[1]) << 48) + (uint64_t(data[0]) << 56);
 }
 
-int64_t read_next(const uint8_t *buf, size_t len, LCMEvent *event)
+WindowedReader::WindowedReader(foxglove_data_loader::Reader reader_, size_t window_size_)
+    : reader(reader_), window(window_size_), window_size(window_size_), window_start(0), window_len(0)
+{
+    file_size = reader.size();
+}
+
+const uint8_t *WindowedReader::fetch(uint64_t pos, size_t len, size_t readahead)
+{
+    if (pos >= window_start && pos + len <= window_start + window_len)
+    {
+        return window.data() + (pos - window_start);
+    }
+    if (pos > file_size || len > file_size - pos)
+    {
+        return nullptr;
+    }
+    // refill the window starting at `pos`, reading the range and as much after it as is wanted and
+    // fits.
+    size_t to_read = len + std::min(readahead, window_size - std::min(len, window_size));
+    to_read = size_t(std::min<uint64_t>(to_read, file_size - pos));
+    if (to_read > window.size())
+    {
+        window.resize(to_read);
+    }
+    else if (window.size() > window_size && to_read <= window_size)
+    {
+        // a range larger than the window was fetched before, so give its memory back.
+        window.resize(window_size);
+        window.shrink_to_fit();
+    }
+    reader.seek(pos);
+    window_start = pos;
+    window_len = 0;
+    while (window_len < to_read)
+    {
+        uint64_t n = reader.read(window.data() + window_len, to_read - window_len);
+        if (n == 0)
+        {
+            break;
+        }
+        window_len += n;
+    }
+    if (window_len < len)
+    {
+        return nullptr;
+    }
+    return window.data();
+}
+
+int64_t read_header(const uint8_t *buf, size_t len, LCMEventHeader *header)
 {
     if (len == 0)
     {
         return 0;
     }
-    if (len < 4 + 8 + 8 + 8)
+    if (len < EVENT_HEADER_LEN)
     {
         return UNEXPECTED_EOF;
     }
@@ -29,23 +87,129 @@ int64_t read_next(const uint8_t *buf, size_t len, LCMEvent *event)
         return MALFORMED_EVENT;
     }
     cursor += 4;
-    event->event_number = decode_u64(&buf[cursor]);
+    header->event_number = decode_u64(&buf[cursor]);
     cursor += 8;
-    event->timestamp_us = decode_u64(&buf[cursor]);
+    header->timestamp_us = decode_u64(&buf[cursor]);
     cursor += 8;
-    uint32_t channel_len = decode_u32(&buf[cursor]);
+    header->channel_len = decode_u32(&buf[cursor]);
     cursor += 4;
-    uint32_t data_len = decode_u32(&buf[cursor]);
+    header->data_len = decode_u32(&buf[cursor]);
     cursor += 4;
+    return int64_t(cursor);
+}
 
-    const uint8_t *channel_start = buf + cursor;
-    const uint8_t *data_start = buf + cursor + channel_len;
+int64_t read_next(const uint8_t *buf, size_t len, LCMEvent *event)
+{
+    LCMEventHeader header;
+    int64_t cursor = read_header(buf, len, &header);
+    if (cursor <= 0)
+    {
+        return cursor;
+    }
+    if (len - cursor < uint64_t(header.channel_len) + header.data_len)
+    {
+        return UNEXPECTED_EOF;
+    }
+    event->event_number = header.event_number;
+    event->timestamp_us = header.timestamp_us;
 
-    // copy channel into channel string
-    event->channel = std::string(reinterpret_cast<const char *>(channel_start), channel_len);
+    event->channel = std::string_view(reinterpret_cast<const char *>(buf + cursor), header.channel_len);
+    event->data = foxglove_data_loader::BytesView{
+        .ptr = buf + cursor + header.channel_len,
+        .len = header.data_len,
+    };
+    return cursor + header.channel_len + header.data_len;
+}
 
-    // copy data into data vector
-    event->data.resize(data_len);
-    memcpy(event->data.data(), data_start, data_len);
-    return int64_t(cursor + channel_len + data_len);
+size_t find_sync_word(const uint8_t *buf, size_t len)
+{
+    // Compare four overlapping loads against the four sync word bytes, so that lane `i` of the
+    // combined mask is set when the sync word starts at `buf + i`.
+    size_t i = 0;
+#if defined(__wasm_simd128__)
+    auto load = [buf](size_t pos)
+    { return wasm_v128_load(buf + pos); };
+    const v128_t b0 = wasm_i8x16_splat(int8_t(SYNC_WORD >> 24));
+    const v128_t b1 = wasm_i8x16_splat(int8_t(SYNC_WORD >> 16));
+    const v128_t b2 = wasm_i8x16_splat(int8_t(SYNC_WORD >> 8));
+    const v128_t b3 = wasm_i8x16_splat(int8_t(SYNC_WORD));
+    for (; i + 16 + 3 <= len; i += 16)
+    {
+        v128_t m = wasm_v128_and(
+            wasm_v128_and(wasm_i8x16_eq(load(i), b0), wasm_i8x16_eq(load(i + 1), b1)),
+            wasm_v128_and(wasm_i8x16_eq(load(i + 2), b2), wasm_i8x16_eq(load(i + 3), b3)));
+        uint32_t mask = wasm_i8x16_bitmask(m);
+        if (mask != 0)
+        {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#elif defined(__AVX2__)
+    auto load = [buf](size_t pos)
+    { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(buf + pos)); };
+    const __m256i b0 = _mm256_set1_epi8(char(SYNC_WORD >> 24));
+    const __m256i b1 = _mm256_set1_epi8(char(SYNC_WORD >> 16));
+    const __m256i b2 = _mm256_set1_epi8(char(SYNC_WORD >> 8));
+    const __m256i b3 = _mm256_set1_epi8(char(SYNC_WORD));
+    for (; i + 32 + 3 <= len; i += 32)
+    {
+        __m256i m = _mm256_and_si256(
+            _mm256_and_si256(_mm256_cmpeq_epi8(load(i), b0), _mm256_cmpeq_epi8(load(i + 1), b1)),
+            _mm256_and_si256(_mm256_cmpeq_epi8(load(i + 2), b2), _mm256_cmpeq_epi8(load(i + 3), b3)));
+        uint32_t mask = uint32_t(_mm256_movemask_epi8(m));
+        if (mask != 0)
+        {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#elif defined(__SSE2__)
+    auto load = [buf](size_t pos)
+    { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf + pos)); };
+    const __m128i b0 = _mm_set1_epi8(char(SYNC_WORD >> 24));
+    const __m128i b1 = _mm_set1_epi8(char(SYNC_WORD >> 16));
+    const __m128i b2 = _mm_set1_epi8(char(SYNC_WORD >> 8));
+    const __m128i b3 = _mm_set1_epi8(char(SYNC_WORD));
+    for (; i + 16 + 3 <= len; i += 16)
+    {
+        __m128i m = _mm_and_si128(
+            _mm_and_si128(_mm_cmpeq_epi8(load(i), b0), _mm_cmpeq_epi8(load(i + 1), b1)),
+            _mm_and_si128(_mm_cmpeq_epi8(load(i + 2), b2), _mm_cmpeq_epi8(load(i + 3), b3)));
+        uint32_t mask = uint32_t(_mm_movemask_epi8(m));
+        if (mask != 0)
+        {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#endif
+    for (; i + 4 <= len; i++)
+    {
+        if (decode_u32(buf + i) == SYNC_WORD)
+        {
+            return i;
+        }
+    }
+    return len;
+}
+
+int64_t read_event_at(WindowedReader &reader, uint64_t offset, LCMEvent *event, bool read_ahead)
+{
+    size_t readahead = read_ahead ? SIZE_MAX : 0;
+    const uint8_t *buf = reader.fetch(offset, EVENT_HEADER_LEN, readahead);
+    if (buf == nullptr)
+    {
+        return UNEXPECTED_EOF;
+    }
+    LCMEventHeader header;
+    int64_t header_len = read_header(buf, EVENT_HEADER_LEN, &header);
+    if (header_len < 0)
+    {
+        return header_len;
+    }
+    size_t event_len = EVENT_HEADER_LEN + size_t(header.channel_len) + header.data_len;
+    buf = reader.fetch(offset, event_len, readahead);
+    if (buf == nullptr)
+    {
+        return UNEXPECTED_EOF;
+    }
+    return read_next(buf, event_len, event);
 }
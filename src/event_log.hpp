@@ -1,6 +1,8 @@
 #pragma once
+#include <cstdint>
 #include <vector>
 #include <string>
+#include <string_view>
 
 #include "foxglove_data_loader/data_loader.hpp"
 
@@ -8,12 +10,66 @@ constexpr int64_t REACHED_EOF = -1;
 constexpr int64_t UNEXPECTED_EOF = -2;
 constexpr int64_t MALFORMED_EVENT = -3;
 
+/** sync word, event number, timestamp, channel length, data length */
+constexpr size_t EVENT_HEADER_LEN = 4 + 8 + 8 + 4 + 4;
+
+/** Longest channel name accepted when checking whether bytes look like an event header. */
+constexpr uint32_t MAX_CHANNEL_LEN = 1024;
+
+struct LCMEventHeader
+{
+    uint64_t event_number;
+    uint64_t timestamp_us;
+    uint32_t channel_len;
+    uint32_t data_len;
+};
+
+/** A non-owning view of an event. `channel` and `data` point into the buffer it was read from. */
 struct LCMEvent
 {
     uint64_t event_number;
     uint64_t timestamp_us;
-    std::string channel;
-    std::vector<uint8_t> data;
+    std::string_view channel;
+    foxglove_data_loader::BytesView data;
+};
+
+/** Provides access to byte ranges of a file through a bounded window, so that no more than
+ * `window_size` bytes (or a single range, if larger) of the file are held in memory at once.
+ * It seeks before every read, so several may share one Reader.
+ */
+class WindowedReader
+{
+    foxglove_data_loader::Reader reader;
+    std::vector<uint8_t> window;
+    size_t window_size;
+    uint64_t window_start;
+    size_t window_len;
+    uint64_t file_size;
+
+public:
+    WindowedReader(foxglove_data_loader::Reader reader, size_t window_size);
+
+    uint64_t size() const { return file_size; }
+
+    /** Returns a pointer to `len` bytes of the file starting at `pos`, or nullptr if the range
+     * extends past the end of the file. The pointer is valid until the next call to `fetch`.
+     *
+     * If the range is not in the window, the window is refilled from `pos` with up to `readahead`
+     * bytes beyond the range, as far as `window_size` allows. Callers that know their next fetch is
+     * elsewhere in the file pass 0 so that only the range itself is read.
+     */
+    const uint8_t *fetch(uint64_t pos, size_t len, size_t readahead = SIZE_MAX);
 };
 
+/** Decodes the fixed-size header of the event at the start of `buf`. Returns the header length,
+ * 0 if `len` is 0, or a negative error code. */
+int64_t read_header(const uint8_t *buf, size_t len, LCMEventHeader *header);
+
 int64_t read_next(const uint8_t *buf, size_t len, LCMEvent *event);
+
+/** Returns the offset of the first event sync word in `buf`, or `len` if there is none. */
+size_t find_sync_word(const uint8_t *buf, size_t len);
+
+/** Reads the event starting at file offset `offset`. The event is valid until the next read from
+ * `reader`. Unless `read_ahead` is set, only that event's bytes are read from the file. */
+int64_t read_event_at(WindowedReader &reader, uint64_t offset, LCMEvent *event, bool read_ahead = true);
@@ -0,0 +1,50 @@
+#include "laser_batch.hpp"
+#include "lcm_views.hpp"
+
+#include <cstring>
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+void widen_be_floats(const uint8_t *in, int32_t count, uint8_t *out)
+{
+    int32_t i = 0;
+    // Four values at a time: byte-swap each lane, then widen the low and high pairs.
+#if defined(__wasm_simd128__)
+    for (; i + 4 <= count; i += 4)
+    {
+        v128_t v = wasm_v128_load(in + 4 * i);
+        v = wasm_i8x16_shuffle(v, v, 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+        wasm_v128_store(out + 8 * i, wasm_f64x2_promote_low_f32x4(v));
+        wasm_v128_store(out + 8 * i + 16, wasm_f64x2_promote_low_f32x4(wasm_i32x4_shuffle(v, v, 2, 3, 2, 3)));
+    }
+#elif defined(__SSE2__)
+#if defined(__SSSE3__)
+    const __m128i swap = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+#endif
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 4 * i));
+#if defined(__SSSE3__)
+        v = _mm_shuffle_epi8(v, swap);
+#else
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+#endif
+        __m128 f = _mm_castsi128_ps(v);
+        _mm_storeu_pd(reinterpret_cast<double *>(out + 8 * i), _mm_cvtps_pd(f));
+        _mm_storeu_pd(reinterpret_cast<double *>(out + 8 * i + 16), _mm_cvtps_pd(_mm_movehl_ps(f, f)));
+    }
+#endif
+    // Both targets are little-endian, so doubles are stored as they are.
+    for (; i < count; i++)
+    {
+        double v = load_be_float(in + 4 * i);
+        memcpy(out + 8 * i, &v, sizeof(v));
+    }
+}
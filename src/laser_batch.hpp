@@ -0,0 +1,7 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/** Converts `count` big-endian float32s at `in` to little-endian float64s at `out`, as they appear
+ * in a packed repeated double field. Neither pointer needs to be aligned. */
+void widen_be_floats(const uint8_t *in, int32_t count, uint8_t *out);
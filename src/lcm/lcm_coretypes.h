@@ -6,6 +6,16 @@
 #include <string.h>
 #include <stdlib.h>
 
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -29,6 +39,66 @@ struct ___lcm_hash_ptr
     void *v;
 };
 
+/**
+ * Copies as many whole vectors of `elements` values of `size` (2, 4 or 8) bytes from `src` to `dst`
+ * as fit, reversing the bytes of each value. LCM is big-endian and every SIMD target is
+ * little-endian, so this both encodes and decodes. Returns the number of values copied; the caller
+ * converts the rest one at a time. Neither pointer needs to be aligned.
+ */
+static inline int __lcm_byteswap_bulk(uint8_t *dst, const uint8_t *src, int elements, int size)
+{
+    int done = 0;
+#if defined(__wasm_simd128__)
+    for (; done + 16 / size <= elements; done += 16 / size) {
+        v128_t v = wasm_v128_load(src + done * size);
+        if (size == 2)
+            v = wasm_i8x16_shuffle(v, v, 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+        else if (size == 4)
+            v = wasm_i8x16_shuffle(v, v, 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+        else
+            v = wasm_i8x16_shuffle(v, v, 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+        wasm_v128_store(dst + done * size, v);
+    }
+#elif defined(__SSSE3__)
+    __m128i mask;
+    if (size == 2)
+        mask = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    else if (size == 4)
+        mask = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    else
+        mask = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+#if defined(__AVX2__)
+    // pshufb shuffles within each 128-bit lane, so the same mask serves both lanes
+    __m256i wide_mask = _mm256_broadcastsi128_si256(mask);
+    for (; done + 32 / size <= elements; done += 32 / size) {
+        __m256i v = _mm256_loadu_si256((const __m256i*) (src + done * size));
+        _mm256_storeu_si256((__m256i*) (dst + done * size), _mm256_shuffle_epi8(v, wide_mask));
+    }
+#endif
+    for (; done + 16 / size <= elements; done += 16 / size) {
+        __m128i v = _mm_loadu_si128((const __m128i*) (src + done * size));
+        _mm_storeu_si128((__m128i*) (dst + done * size), _mm_shuffle_epi8(v, mask));
+    }
+#elif defined(__SSE2__)
+    for (; done + 16 / size <= elements; done += 16 / size) {
+        __m128i v = _mm_loadu_si128((const __m128i*) (src + done * size));
+        // swap bytes within 16-bit words, then words within 32-bit values, then those within 64
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        if (size >= 4)
+            v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+        if (size == 8)
+            v = _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+        _mm_storeu_si128((__m128i*) (dst + done * size), v);
+    }
+#else
+    (void) dst;
+    (void) src;
+    (void) elements;
+    (void) size;
+#endif
+    return done;
+}
+
 /**
  * BOOLEAN
  */
@@ -141,7 +211,9 @@ static inline int __int16_t_encode_array(void *_buf, int offset, int maxlen, con
     if (maxlen < total_size)
         return -1;
 
-    for (element = 0; element < elements; element++) {
+    element = __lcm_byteswap_bulk(&buf[pos], (const uint8_t*) p, elements, sizeof(int16_t));
+    pos += element * sizeof(int16_t);
+    for (; element < elements; element++) {
         int16_t v = p[element];
         buf[pos++] = (v>>8) & 0xff;
         buf[pos++] = (v & 0xff);
@@ -160,7 +232,9 @@ static inline int __int16_t_decode_array(const void *_buf, int offset, int maxle
     if (maxlen < total_size)
         return -1;
 
-    for (element = 0; element < elements; element++) {
+    element = __lcm_byteswap_bulk((uint8_t*) p, &buf[pos], elements, sizeof(int16_t));
+    pos += element * sizeof(int16_t);
+    for (; element < elements; element++) {
         p[element] = (buf[pos]<<8) + buf[pos+1];
         pos+=2;
     }
@@ -196,7 +270,9 @@ static inline int __int32_t_encode_array(void *_buf, int offset, int maxlen, con
     if (maxlen < total_size)
         return -1;
 
-    for (element = 0; element < elements; element++) {
+    element = __lcm_byteswap_bulk(&buf[pos], (const uint8_t*) p, elements, sizeof(int32_t));
+    pos += element * sizeof(int32_t);
+    for (; element < elements; element++) {
         int32_t v = p[element];
         buf[pos++] = (v>>24)&0xff;
         buf[pos++] = (v>>16)&0xff;
@@ -217,7 +293,9 @@ static inline int __int32_t_decode_array(const void *_buf, int offset, int maxle
     if (maxlen < total_size)
         return -1;
 
-    for (element = 0; element < elements; element++) {
+    element = __lcm_byteswap_bulk((uint8_t*) p, &buf[pos], elements, sizeof(int32_t));
+    pos += element * sizeof(int32_t);
+    for (; element < elements; element++) {
         p[element] = (buf[pos+0]<<24) + (buf[pos+1]<<16) + (buf[pos+2]<<8) + buf[pos+3];
         pos+=4;
     }
@@ -253,7 +331,9 @@ static inline int __int64_t_encode_array(void *_buf, int offset, int maxlen, con
     if (maxlen < total_size)
         return -1;
 
-    for (element = 0; element < elements; element++) {
+    element = __lcm_byteswap_bulk(&buf[pos], (const uint8_t*) p, elements, sizeof(int64_t));
+    pos += element * sizeof(int64_t);
+    for (; element < elements; element++) {
         int64_t v = p[element];
         buf[pos++] = (v>>56)&0xff;
         buf[pos++] = (v>>48)&0xff;
@@ -278,7 +358,9 @@ static inline int __int64_t_decode_array(const void *_buf, int offset, int maxle
     if (maxlen < total_size)
         return -1;
 
-    for (element = 0; element < elements; element++) {
+    element = __lcm_byteswap_bulk((uint8_t*) p, &buf[pos], elements, sizeof(int64_t));
+    pos += element * sizeof(int64_t);
+    for (; element < elements; element++) {
         int64_t a = (buf[pos+0]<<24) + (buf[pos+1]<<16) + (buf[pos+2]<<8) + buf[pos+3];
         pos+=4;
         int64_t b = (buf[pos+0]<<24) + (buf[pos+1]<<16) + (buf[pos+2]<<8) + buf[pos+3];
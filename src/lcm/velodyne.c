@@ -197,29 +197,20 @@ void velodyne_calib_dump(velodyne_calib_t *v)
 }
 
 
-static velodyne_calib_t *__v;
-static int laser_phi_compare(const void *_a, const void *_b)
-{
-    int a = *((int*) _a);
-    int b = *((int*) _b);
-
-    if (__v->lasers[a].vcf < __v->lasers[b].vcf) 
-        return -1;
-    return 1;
-}
-
-// NOT REENTRANT
+// Reentrant: the logical order is found with an insertion sort over this
+// calibration alone, rather than qsort with a comparator that reads a global.
 int velodyne_calib_precompute(velodyne_calib_t *v)
 {
-    assert (!__v); // check for reentrancy...
-
-    __v = v;
-
     int i;
-    for (i = 0; i < VELODYNE_NUM_LASERS; i++)
-        v->logical2physical[i] = i;
-    qsort(v->logical2physical, VELODYNE_NUM_LASERS, sizeof(int), 
-            laser_phi_compare);
+    for (i = 0; i < VELODYNE_NUM_LASERS; i++) {
+        int physical = i;
+        int j = i;
+        while (j > 0 && v->lasers[physical].vcf < v->lasers[v->logical2physical[j-1]].vcf) {
+            v->logical2physical[j] = v->logical2physical[j-1];
+            j--;
+        }
+        v->logical2physical[j] = physical;
+    }
     
     int logical;
     for (logical = 0; logical < VELODYNE_NUM_LASERS; logical++) {
@@ -231,7 +222,6 @@ int velodyne_calib_precompute(velodyne_calib_t *v)
         v->sincos[physical][0] = sin(v->lasers[physical].vcf);
         v->sincos[physical][1] = cos(v->lasers[physical].vcf);
     }
-    __v = NULL;
 
     return 0;
 }
@@ -69,7 +69,7 @@ extern "C"
 
     velodyne_calib_t *velodyne_calib_create();
 
-    // NOT REENTRANT.
+    // Reentrant; touches only *v.
     // Compute the logical laser numbers given the current phi angles
     // (necessary before calls to p2l or l2p)
     int velodyne_calib_precompute(velodyne_calib_t *v);
@@ -1,24 +1,43 @@
 #define FOXGLOVE_DATA_LOADER_IMPLEMENTATION
 #include "foxglove_data_loader/data_loader.hpp"
+#include "backfill.hpp"
 #include "event_log.hpp"
+#include "log_index.hpp"
+#include "pose_track.hpp"
 #include "transcode.hpp"
-#include <foxglove/schemas.hpp>
+#include "transcoder_registry.hpp"
+#include "velodyne_calib.hpp"
+#include "lcm/lcmtypes_pose_t.h"
 
+#include <algorithm>
+#include <cstring>
 #include <memory>
+#include <optional>
+#include <queue>
 #include <sstream>
+#include <unordered_set>
 
-constexpr uint16_t CHANNEL_CAM_THUMB_RFR = 1;
-constexpr uint16_t CHANNEL_CAM_THUMB_RFC = 2;
-constexpr uint16_t CHANNEL_VELODYNE = 3;
-constexpr uint16_t CHANNEL_BROOM_L = 4;
-constexpr uint16_t CHANNEL_BROOM_R = 5;
-constexpr uint16_t CHANNEL_BROOM_C = 6;
-constexpr uint16_t CHANNEL_BROOM_CL = 7;
-constexpr uint16_t CHANNEL_BROOM_CR = 8;
+/** Channel ids are assigned as channels are discovered, counting up from here. */
+constexpr uint16_t FIRST_CHANNEL_ID = 1;
+/** Most channels advertised for one discovered channel: a Velodyne channel, its sweeps, their
+ * local-frame projections and their decimations. */
+constexpr size_t MAX_CHANNELS_PER_DISCOVERED = 6;
+/** Channels of unknown types named individually before the rest are counted in one problem. */
+constexpr size_t MAX_UNKNOWN_TOPICS_LISTED = 10;
 
-constexpr uint16_t SCHEMA_COMPRESSED_IMAGE = 1;
-constexpr uint16_t SCHEMA_POINT_CLOUD = 2;
-constexpr uint16_t SCHEMA_LASER_SCAN = 3;
+constexpr int SEVERITY_INFO = 0;
+constexpr int SEVERITY_WARN = 1;
+
+/** Skipped byte ranges reported individually before the rest are summarized in one problem. */
+constexpr size_t MAX_SKIPPED_PROBLEMS = 10;
+
+/** Bytes of the log held in memory while indexing it in initialize(). */
+constexpr size_t SCAN_WINDOW_SIZE = 4 * 1024 * 1024;
+/** Bytes of the log held in memory by each message iterator. */
+constexpr size_t ITERATOR_WINDOW_SIZE = 256 * 1024;
+/** Bytes of the log held in memory for reading POSE events. They are small and spread between much
+ * larger sensor events, so a window rarely holds more than one. */
+constexpr size_t POSE_WINDOW_SIZE = 4 * 1024;
 
 using namespace foxglove_data_loader;
 
@@ -58,14 +77,60 @@ void error(Types... vars)
   console_error(as_string.c_str());
 }
 
-struct EventIndex
+bool has_suffix(const std::string &path, const char *suffix)
 {
-  uint64_t offset;
-  uint16_t channel_id;
-  uint16_t schema_id;
-  uint64_t timestamp_ns;
+  return path.size() > strlen(suffix) && path.compare(path.size() - strlen(suffix), std::string::npos, suffix) == 0;
+}
+
+/** How the messages on an advertised channel are built from the log. */
+struct ChannelSource
+{
+  /** Transcodes the events that messages are built from. Resolved from their fingerprint once, in
+   * initialize(). nullptr if the id is not advertised. */
+  const TranscoderEntry *transcoder = nullptr;
+  /** The channel whose events messages are built from: the channel itself, or the Velodyne channel
+   * that a sweep, local or decimated channel is derived from. */
+  ChannelId events = 0;
+  /** Velodyne packets assembled into one point cloud per revolution. */
+  bool sweep = false;
+  /** Point clouds projected into the local frame using the vehicle's POSE. */
+  bool local = false;
+  /** Point clouds thinned by a PointDownsampler. */
+  bool decimated = false;
+  std::string frame_id;
 };
 
+/** The frame of messages on a channel named `topic` that carries `transcoder`'s type. */
+std::string frame_for(const TranscoderEntry &transcoder, const std::string &topic)
+{
+  if (transcoder.frame_policy == FramePolicy::LOCAL)
+  {
+    return LOCAL_FRAME_ID;
+  }
+  std::string frame = topic;
+  for (char &c : frame)
+  {
+    if (c >= 'A' && c <= 'Z')
+    {
+      c = char(c - 'A' + 'a');
+    }
+  }
+  return frame;
+}
+
+Schema make_schema(uint16_t id, const foxglove::Schema &schema)
+{
+  return Schema{
+      .id = id,
+      .name = schema.name,
+      .encoding = schema.encoding,
+      .data = BytesView{
+          .ptr = reinterpret_cast<const uint8_t *>(schema.data),
+          .len = schema.data_len,
+      },
+  };
+}
+
 /** A simple data loader implementation that loads text files and yields each line as a message.
  * This data loader is initialized with a set of text files, which it reads into memory.
  * `create_iterator` returns an iterator which iterates over each file line-by-line, assigning
@@ -75,13 +140,49 @@ class LCMDataLoader : public foxglove_data_loader::AbstractDataLoader
 {
 public:
   std::vector<std::string> paths;
+  std::string log_path;
+  std::string index_path;
+  std::string calibration_path;
+  /** The log, opened once in initialize(). The SDK never releases a Reader's host handle, so every
+   * WindowedReader over the log, including those of the PoseTracks, shares this one; each seeks
+   * before it reads. */
+  std::optional<Reader> log_reader;
+  /** Shared by the transcoders of every iterator. */
+  std::shared_ptr<const VelodyneCalibration> velodyne_calibration;
+  /** Read from the `downsample.*` keys of the calibration file, if there is one. */
+  DownsampleConfig downsample_config;
+  /** Read from the `pointcloud.*` keys of the calibration file, if there is one. */
+  PointCloudConfig point_cloud_config;
   std::vector<EventIndex> index;
-  std::vector<uint8_t> buffer;
+  PoseIndex pose_index;
+  /** For each channel ID, how its messages are built. */
+  std::vector<ChannelSource> channel_sources;
+  /** For each channel ID, the positions in `index` of that channel's events. Empty for channels
+   * whose messages are built from another channel's events. */
+  std::vector<std::vector<uint32_t>> channel_events;
   LCMDataLoader(std::vector<std::string> paths);
 
+  /** Returns how the messages on `channel_id` are built, or nullptr if it is not advertised. */
+  const ChannelSource *channel_source(ChannelId channel_id) const;
+
+  /** Returns the position in `channel_events[channel_id]` of the channel's first event at or after
+   * `time`. */
+  size_t channel_lower_bound(ChannelId channel_id, TimeNanos time) const;
+  /** Returns the position in `channel_events[channel_id]` of the channel's first event after
+   * `time`. */
+  size_t channel_upper_bound(ChannelId channel_id, TimeNanos time) const;
+
   Result<Initialization> initialize() override;
 
   Result<std::unique_ptr<AbstractMessageIterator>> create_iterator(const MessageIteratorArgs &args) override;
+
+  Result<std::vector<Message>> get_backfill(const BackfillArgs &args) override;
+
+private:
+  /** Created by the first call to get_backfill. */
+  std::unique_ptr<Backfill> backfill;
+  /** Serialized backfill messages, which must stay valid until the next call. */
+  std::vector<std::vector<uint8_t>> backfill_messages;
 };
 
 /** Iterates over 'messages' that match the requested args. */
@@ -89,10 +190,30 @@ class LCMMessageIterator : public foxglove_data_loader::AbstractMessageIterator
 {
   LCMDataLoader *data_loader;
   MessageIteratorArgs args;
-  size_t index_pos;
+  /** A selected channel's events, and the next of them to be merged into the output. */
+  struct ChannelCursor
+  {
+    ChannelId channel_id;
+    const ChannelSource *source;
+    const std::vector<uint32_t> *positions;
+    size_t next;
+    /** For sweep channels, the first block of the next packet that belongs to `sweep`. */
+    int32_t first_block;
+    std::unique_ptr<VelodyneSweep> sweep;
+    /** For the decimated channels. */
+    std::unique_ptr<PointDownsampler> downsampler;
+  };
+  std::vector<ChannelCursor> cursors;
+  /** (index position, cursor) of the next event of each channel, smallest position first. */
+  std::priority_queue<std::pair<uint32_t, uint16_t>, std::vector<std::pair<uint32_t, uint16_t>>, std::greater<>> pending;
+  WindowedReader reader;
   std::vector<uint8_t> last_serialized_message;
   Transcoder transcoder;
   LCMEvent current_event;
+  /** Only created if a local-frame channel is selected. */
+  std::unique_ptr<PoseTrack> poses;
+
+  bool next_event_in_window(const ChannelCursor &cursor, uint64_t offset) const;
 
 public:
   explicit LCMMessageIterator(LCMDataLoader *loader, MessageIteratorArgs args_);
@@ -106,174 +227,319 @@ LCMDataLoader::LCMDataLoader(std::vector<std::string> paths)
 
 /** initialize() is meant to read and return summary information to the foxglove
  * application about the set of files being read. The loader should also read any index information
- * that it needs to iterate over messages in initialize(). For simplicity, this loader reads entire
- * input files and indexes their line endings, but more sophisticated formats should not need to
- * be read from front to back.
+ * that it needs to iterate over messages in initialize(). LCM logs have no index, so unless a sidecar
+ * index built by `lcm-index` is opened alongside the log, this loader streams through the file once
+ * through a bounded window and records the offset of every event. Event payloads are not kept in
+ * memory.
  */
 Result<Initialization> LCMDataLoader::initialize()
 {
-  if (paths.size() != 1)
+  // One log may be opened alongside its sidecar index and a calibration file.
+  for (const std::string &path : paths)
+  {
+    if (has_suffix(path, LOG_INDEX_SUFFIX))
+    {
+      index_path = path;
+    }
+    else if (has_suffix(path, CALIBRATION_SUFFIX))
+    {
+      calibration_path = path;
+    }
+    else if (log_path.empty())
+    {
+      log_path = path;
+    }
+    else
+    {
+      return Result<Initialization>{.error = "Only one log file supported"};
+    }
+  }
+  if (log_path.empty())
   {
-    return Result<Initialization>{.error = "Only one file supported"};
+    return Result<Initialization>{.error = "No log file provided"};
   }
-  const std::string &path = paths[0];
-
-  foxglove::Schema pointcloud_schema = foxglove::schemas::PointCloud::schema();
-  foxglove::Schema laserscan_schema = foxglove::schemas::LaserScan::schema();
-  foxglove::Schema image_schema = foxglove::schemas::CompressedImage::schema();
-
-  std::vector<Schema> schemas = {
-      Schema{
-          .id = SCHEMA_POINT_CLOUD,
-          .name = pointcloud_schema.name,
-          .encoding = pointcloud_schema.encoding,
-          .data = BytesView{
-              .ptr = reinterpret_cast<const uint8_t*>(pointcloud_schema.data),
-              .len = pointcloud_schema.data_len,
-          },
-      },
-      Schema{
-          .id = SCHEMA_LASER_SCAN,
-          .name = laserscan_schema.name,
-          .encoding = pointcloud_schema.encoding,
-          .data = BytesView{
-              .ptr = reinterpret_cast<const uint8_t*>(laserscan_schema.data),
-              .len = laserscan_schema.data_len,
-          },
-      },
-      Schema{
-          .id = SCHEMA_COMPRESSED_IMAGE,
-          .name = image_schema.name,
-          .encoding = image_schema.encoding,
-          .data = BytesView{
-              .ptr = reinterpret_cast<const uint8_t*>(image_schema.data),
-              .len = image_schema.data_len,
-          },
-      },
-  };
-  std::vector<Channel> channels = {
-      Channel{
-          .id = CHANNEL_CAM_THUMB_RFR,
-          .schema_id = SCHEMA_COMPRESSED_IMAGE,
-          .topic_name = "CAM_THUMB_RFR",
-          .message_encoding = "protobuf",
-          .message_count = 0,
-      },
-      Channel{
-          .id = CHANNEL_CAM_THUMB_RFC,
-          .schema_id = SCHEMA_COMPRESSED_IMAGE,
-          .topic_name = "CAM_THUMB_RFC",
-          .message_encoding = "protobuf",
-          .message_count = 0,
-      },
-      Channel{
-          .id = CHANNEL_VELODYNE,
-          .schema_id = SCHEMA_POINT_CLOUD,
-          .topic_name = "VELODYNE",
-          .message_encoding = "protobuf",
-          .message_count = 0,
-      },
-      Channel{
-          .id = CHANNEL_BROOM_L,
-          .schema_id = SCHEMA_LASER_SCAN,
-          .topic_name = "BROOM_L",
-          .message_encoding = "protobuf",
-          .message_count = 0,
-      },
-      Channel{
-          .id = CHANNEL_BROOM_R,
-          .schema_id = SCHEMA_LASER_SCAN,
-          .topic_name = "BROOM_R",
-          .message_encoding = "protobuf",
-          .message_count = 0,
-      },
-      Channel{
-          .id = CHANNEL_BROOM_C,
-          .schema_id = SCHEMA_LASER_SCAN,
-          .topic_name = "BROOM_C",
-          .message_encoding = "protobuf",
-          .message_count = 0,
-      },
-      Channel{
-          .id = CHANNEL_BROOM_CL,
-          .schema_id = SCHEMA_LASER_SCAN,
-          .topic_name = "BROOM_CL",
-          .message_encoding = "protobuf",
-          .message_count = 0,
-      },
-      Channel{
-          .id = CHANNEL_BROOM_CR,
-          .schema_id = SCHEMA_LASER_SCAN,
-          .topic_name = "BROOM_CR",
-          .message_encoding = "protobuf",
-          .message_count = 0,
-      },
-  };
 
+  std::vector<Schema> schemas;
+  for (size_t i = 0; i < TRANSCODER_COUNT; i++)
+  {
+    const TranscoderEntry &transcoder = TRANSCODERS[i];
+    bool listed = std::any_of(schemas.begin(), schemas.end(), [&](const Schema &schema)
+                              { return schema.id == transcoder.schema_id; });
+    if (!listed)
+    {
+      schemas.push_back(make_schema(transcoder.schema_id, transcoder.schema()));
+    }
+  }
+
+  LogIndex log_index;
+  std::vector<Problem> problems;
+  if (!calibration_path.empty())
+  {
+    WindowedReader calibration_reader(Reader::open(calibration_path.c_str()), 0);
+    const uint8_t *calibration_data = calibration_reader.fetch(0, calibration_reader.size());
+    std::string calibration_error;
+    velodyne_calibration = load_velodyne_calibration(calibration_data, calibration_reader.size(), calibration_path, &calibration_error);
+    if (!velodyne_calibration)
+    {
+      problems.push_back(Problem{
+          .severity = SEVERITY_WARN,
+          .message = calibration_error + ", using the default Velodyne calibration",
+      });
+    }
+    std::string downsample_error;
+    if (velodyne_calibration &&
+        !load_downsample_config(calibration_data, calibration_reader.size(), calibration_path, &downsample_config, &downsample_error))
+    {
+      problems.push_back(Problem{
+          .severity = SEVERITY_WARN,
+          .message = downsample_error + ", using the default downsampling",
+      });
+    }
+    std::string point_cloud_error;
+    if (velodyne_calibration &&
+        !load_point_cloud_config(calibration_data, calibration_reader.size(), calibration_path, &point_cloud_config, &point_cloud_error))
+    {
+      problems.push_back(Problem{
+          .severity = SEVERITY_WARN,
+          .message = point_cloud_error + ", using the default point layout and tables",
+      });
+    }
+  }
+  if (!velodyne_calibration)
+  {
+    velodyne_calibration = default_velodyne_calibration();
+  }
+  log_reader = Reader::open(log_path.c_str());
+  WindowedReader reader(*log_reader, SCAN_WINDOW_SIZE);
+  bool have_index = false;
+  if (!index_path.empty())
+  {
+    WindowedReader index_reader(Reader::open(index_path.c_str()), 0);
+    const uint8_t *index_data = index_reader.fetch(0, index_reader.size());
+    have_index = deserialize_log_index(index_data, index_reader.size(), &log_index) &&
+                 log_index.file_size == reader.size() &&
+                 log_index.content_hash == fingerprint_log(reader);
+    if (!have_index)
+    {
+      problems.push_back(Problem{
+          .severity = SEVERITY_WARN,
+          .message = "index file " + index_path + " does not match this log, rescanning",
+          .tip = "rebuild it with lcm-index",
+      });
+    }
+  }
+  if (!have_index)
+  {
+    // Stream through the file, decoding only event headers and channel names. Event payloads
+    // are fetched on demand by message iterators.
+    int64_t read = scan_log(reader, &log_index);
+    if (read == UNEXPECTED_EOF)
+    {
+      return Result<Initialization>{.error = "failed to decode LCM log: unexpected EOF"};
+    }
+    else if (read == MALFORMED_EVENT)
+    {
+      return Result<Initialization>{.error = "failed to decode LCM log: malformed event"};
+    }
+    else if (read < 0)
+    {
+      return Result<Initialization>{.error = "failed to decode LCM log: unknown error"};
+    }
+  }
+
+  // Recorded logs are often truncated by a crash or power loss, so corrupt regions are reported and
+  // skipped rather than failing the whole log.
+  uint64_t skipped_bytes = 0;
+  for (size_t i = 0; i < log_index.skipped.size(); i++)
+  {
+    const SkippedRange &range = log_index.skipped[i];
+    skipped_bytes += range.end - range.start;
+    if (i < MAX_SKIPPED_PROBLEMS)
+    {
+      problems.push_back(Problem{
+          .severity = SEVERITY_WARN,
+          .message = "skipped " + std::to_string(range.end - range.start) + " corrupt bytes at offset " + std::to_string(range.start),
+      });
+    }
+  }
+  if (log_index.skipped.size() > MAX_SKIPPED_PROBLEMS)
+  {
+    problems.push_back(Problem{
+        .severity = SEVERITY_WARN,
+        .message = "skipped " + std::to_string(log_index.skipped.size()) + " corrupt regions totalling " + std::to_string(skipped_bytes) + " bytes",
+    });
+  }
+
+  // Advertise each channel found in the log whose fingerprint is a type this loader can read, with
+  // ids in order of discovery, then drop events on every other channel. POSE is also kept for
+  // projecting clouds into the local frame.
+  size_t pose_channel = SIZE_MAX;
+  for (size_t i = 0; i < log_index.channels.size(); i++)
+  {
+    const IndexedChannel &indexed = log_index.channels[i];
+    if (indexed.topic == POSE_CHANNEL && indexed.fingerprint == __lcmtypes_pose_t_get_hash())
+    {
+      pose_channel = i;
+    }
+  }
+  std::vector<Channel> channels;
+  std::unordered_set<std::string> topics;
+  channel_sources.assign(FIRST_CHANNEL_ID, ChannelSource{});
+  auto advertise = [&](const std::string &topic, std::optional<uint64_t> count, ChannelSource source)
+  {
+    ChannelId id = ChannelId(channel_sources.size());
+    topics.insert(topic);
+    channels.push_back(Channel{
+        .id = id,
+        .schema_id = source.transcoder->schema_id,
+        .topic_name = topic,
+        .message_encoding = "protobuf",
+        .message_count = count,
+    });
+    channel_sources.push_back(std::move(source));
+    return id;
+  };
   uint64_t start_time_ns = UINT64_MAX;
   uint64_t end_time_ns = 0;
+  std::vector<ChannelId> advertised(log_index.channels.size(), 0);
+  std::vector<std::string> unknown_topics;
+  for (size_t i = 0; i < log_index.channels.size(); i++)
   {
-    Reader reader = Reader::open(path.c_str());
-    buffer.resize(reader.size());
-    uint64_t n_read = reader.read(buffer.data(), buffer.size());
-    if (n_read != buffer.size())
+    const IndexedChannel &indexed = log_index.channels[i];
+    const TranscoderEntry *transcoder = find_transcoder(indexed.fingerprint);
+    if (transcoder == nullptr)
+    {
+      unknown_topics.push_back(indexed.topic);
+      continue;
+    }
+    if (channel_sources.size() + MAX_CHANNELS_PER_DISCOVERED > UINT16_MAX)
+    {
+      problems.push_back(Problem{
+          .severity = SEVERITY_WARN,
+          .message = "too many channels, only the first " + std::to_string(channels.size()) + " are shown",
+      });
+      break;
+    }
+    start_time_ns = std::min(start_time_ns, indexed.start_time_ns);
+    end_time_ns = std::max(end_time_ns, indexed.end_time_ns);
+    // A name that already carries another type gets this type's name after each of its topics, so
+    // that no two channels share a topic.
+    std::string tag;
+    if (topics.count(indexed.topic) > 0)
     {
-      return Result<Initialization>{.error = "failed to read entire file"};
+      tag = std::string(" [") + transcoder->lcm_type + "]";
+      problems.push_back(Problem{
+          .severity = SEVERITY_WARN,
+          .message = "channel " + indexed.topic + " carries more than one type, its " + transcoder->lcm_type +
+                     " messages are shown on " + indexed.topic + tag,
+      });
+    }
+    ChannelId id = ChannelId(channel_sources.size());
+    std::string frame_id = frame_for(*transcoder, indexed.topic);
+    advertised[i] = advertise(indexed.topic + tag, indexed.message_count,
+                              ChannelSource{.transcoder = transcoder, .events = id, .frame_id = frame_id});
+    if (!transcoder->velodyne)
+    {
+      continue;
     }
+    // Sweeps are only found by reading every packet, so their count is left unknown.
+    advertise(indexed.topic + "_SWEEP" + tag, std::nullopt,
+              ChannelSource{.transcoder = transcoder, .events = id, .sweep = true, .frame_id = frame_id});
+    if (pose_channel != SIZE_MAX)
+    {
+      advertise(indexed.topic + "_LOCAL" + tag, indexed.message_count,
+                ChannelSource{.transcoder = transcoder, .events = id, .local = true, .frame_id = LOCAL_FRAME_ID});
+      advertise(indexed.topic + "_SWEEP_LOCAL" + tag, std::nullopt,
+                ChannelSource{.transcoder = transcoder, .events = id, .sweep = true, .local = true, .frame_id = LOCAL_FRAME_ID});
+    }
+    advertise(indexed.topic + "/decimated" + tag, indexed.message_count,
+              ChannelSource{.transcoder = transcoder, .events = id, .decimated = true, .frame_id = frame_id});
+    advertise(indexed.topic + "_SWEEP/decimated" + tag, std::nullopt,
+              ChannelSource{.transcoder = transcoder, .events = id, .sweep = true, .decimated = true, .frame_id = frame_id});
+  }
+  if (!unknown_topics.empty())
+  {
+    std::string listed;
+    for (size_t i = 0; i < unknown_topics.size() && i < MAX_UNKNOWN_TOPICS_LISTED; i++)
+    {
+      listed += (i > 0 ? ", " : "") + unknown_topics[i];
+    }
+    if (unknown_topics.size() > MAX_UNKNOWN_TOPICS_LISTED)
+    {
+      listed += " and " + std::to_string(unknown_topics.size() - MAX_UNKNOWN_TOPICS_LISTED) + " more";
+    }
+    problems.push_back(Problem{
+        .severity = SEVERITY_INFO,
+        .message = std::to_string(unknown_topics.size()) + " channels carry LCM types that cannot be transcoded and are not shown: " + listed,
+    });
   }
 
+  std::vector<std::pair<int64_t, uint64_t>> poses;
+  index = std::move(log_index.events);
+  size_t kept = 0;
+  for (const EventIndex &event : index)
   {
-    LCMEvent event = {0};
-    std::vector<uint8_t> scratch;
-    const uint8_t *buf = buffer.data();
-    size_t pos = 0;
-    while (pos != buffer.size())
-    {
-      int64_t read = read_next(buf + pos, buffer.size() - pos, &event);
-      if (read < 0)
-      {
-        if (read == UNEXPECTED_EOF)
-        {
-          return Result<Initialization>{.error = "failed to decode LCM log: unexpected EOF"};
-        }
-        else if (read == MALFORMED_EVENT)
-        {
-          return Result<Initialization>{.error = "failed to decode LCM log: malformed event"};
-        }
-        else
-        {
-          return Result<Initialization>{.error = "failed to decode LCM log: unknown error"};
-        }
-      }
-      if (read == 0)
-      {
-        break;
-      }
-      for (Channel &channel : channels)
-      {
-        if (channel.topic_name == event.channel)
-        {
-          channel.message_count = *channel.message_count + 1;
-          uint64_t timestamp_ns = event.timestamp_us * 1000;
-          if (timestamp_ns < start_time_ns)
-          {
-            start_time_ns = timestamp_ns;
-          }
-          if (timestamp_ns > end_time_ns)
-          {
-            end_time_ns = timestamp_ns;
-          }
-          index.push_back(EventIndex{
-              .offset = pos,
-              .channel_id = channel.id,
-              .schema_id = *channel.schema_id,
-              .timestamp_ns = timestamp_ns,
-          });
-        }
-      }
-      pos += read;
+    if (event.channel_id == pose_channel)
+    {
+      poses.push_back({int64_t(event.timestamp_ns / 1000), event.offset});
+    }
+    ChannelId channel_id = advertised[event.channel_id];
+    if (channel_id != 0)
+    {
+      index[kept++] = EventIndex{
+          .offset = event.offset,
+          .channel_id = channel_id,
+          .schema_id = channel_sources[channel_id].transcoder->schema_id,
+          .timestamp_ns = event.timestamp_ns,
+      };
+    }
+  }
+  index.resize(kept);
+  index.shrink_to_fit();
+
+  std::stable_sort(poses.begin(), poses.end(), [](const auto &a, const auto &b)
+                   { return a.first < b.first; });
+  pose_index.utimes.reserve(poses.size());
+  pose_index.offsets.reserve(poses.size());
+  for (const auto &[utime, offset] : poses)
+  {
+    pose_index.utimes.push_back(utime);
+    pose_index.offsets.push_back(offset);
+  }
+
+  // Iterators binary-search the index by timestamp, so it must be in log time order. LCM logs are
+  // written in receive order and are almost always monotonic, but clock steps and merged logs
+  // are not.
+  size_t out_of_order = 0;
+  for (size_t i = 1; i < index.size(); i++)
+  {
+    if (index[i].timestamp_ns < index[i - 1].timestamp_ns)
+    {
+      out_of_order++;
+    }
+  }
+  if (out_of_order > 0)
+  {
+    std::stable_sort(index.begin(), index.end(), [](const EventIndex &a, const EventIndex &b)
+                     { return a.timestamp_ns < b.timestamp_ns; });
+    problems.push_back(Problem{
+        .severity = SEVERITY_INFO,
+        .message = std::to_string(out_of_order) + " events are out of timestamp order and will be played back in log time order",
+    });
+  }
+
+  channel_events.assign(channel_sources.size(), {});
+  for (const Channel &channel : channels)
+  {
+    if (channel_sources[channel.id].events == channel.id)
+    {
+      channel_events[channel.id].reserve(channel.message_count.value_or(0));
     }
   }
+  for (size_t i = 0; i < index.size(); i++)
+  {
+    channel_events[index[i].channel_id].push_back(uint32_t(i));
+  }
   return Result<Initialization>{
       .value =
           Initialization{
@@ -283,8 +549,88 @@ Result<Initialization> LCMDataLoader::initialize()
                   TimeRange{
                       .start_time = start_time_ns,
                       .end_time = end_time_ns,
-                  }}};
+                  },
+              .problems = problems,
+          }};
+}
+size_t LCMDataLoader::channel_lower_bound(ChannelId channel_id, TimeNanos time) const
+{
+  return events_lower_bound(index, channel_events[channel_id], time);
+}
+
+size_t LCMDataLoader::channel_upper_bound(ChannelId channel_id, TimeNanos time) const
+{
+  return events_upper_bound(index, channel_events[channel_id], time);
+}
+
+const ChannelSource *LCMDataLoader::channel_source(ChannelId channel_id) const
+{
+  if (channel_id >= channel_sources.size() || channel_sources[channel_id].transcoder == nullptr)
+  {
+    return nullptr;
+  }
+  return &channel_sources[channel_id];
+}
+
+/** Returns the latest message at or before `args.time` on each requested channel, found with a
+ * binary search over that channel's events. Only those messages are read and transcoded.
+ */
+Result<std::vector<Message>> LCMDataLoader::get_backfill(const BackfillArgs &args)
+{
+  if (!backfill)
+  {
+    backfill = std::make_unique<Backfill>(&index, *log_reader, ITERATOR_WINDOW_SIZE, &pose_index, POSE_WINDOW_SIZE,
+                                          downsample_config);
+    backfill->transcoder.set_velodyne_calibration(velodyne_calibration);
+    backfill->transcoder.set_velodyne_table_mode(point_cloud_config.table_mode);
+    backfill->transcoder.point_layout = point_cloud_config.layout;
+  }
+  std::vector<Message> messages;
+  backfill_messages.resize(std::max(backfill_messages.size(), args.channel_ids.size()));
+  for (ChannelId channel_id : args.channel_ids)
+  {
+    const ChannelSource *source = channel_source(channel_id);
+    if (source == nullptr)
+    {
+      continue;
+    }
+    BackfillChannel channel{
+        .events = &channel_events[source->events],
+        .transcode = source->transcoder->transcode,
+        .sweep = source->sweep,
+        .local = source->local,
+        .decimated = source->decimated,
+        .frame_id = source->frame_id.c_str(),
+    };
+    std::vector<uint8_t> &serialized = backfill_messages[messages.size()];
+    const EventIndex *event = nullptr;
+    int32_t found = backfill->latest_message(channel, args.time, &serialized, &event);
+    if (found == BACKFILL_UNREADABLE)
+    {
+      error("failed to parse event at offset", event->offset);
+      return Result<std::vector<Message>>{.error = "failed to parse event"};
+    }
+    if (found == BACKFILL_MALFORMED)
+    {
+      warn("skipping malformed event at offset", event->offset, "on channel", channel_id);
+      continue;
+    }
+    if (found == BACKFILL_NONE)
+    {
+      continue;
+    }
+    messages.push_back(Message{
+        .channel_id = channel_id,
+        .log_time = event->timestamp_ns,
+        .publish_time = event->timestamp_ns,
+        .data = BytesView{
+            .ptr = serialized.data(),
+            .len = serialized.size(),
+        }});
+  }
+  return Result<std::vector<Message>>{.value = messages};
 }
+
 /** returns an AbstractMessageIterator for the set of requested args.
  * More than one message iterator may be instantiated at a given time.
  */
@@ -296,29 +642,88 @@ Result<std::unique_ptr<AbstractMessageIterator>> LCMDataLoader::create_iterator(
   };
 }
 
-LCMMessageIterator::LCMMessageIterator(LCMDataLoader *loader, MessageIteratorArgs args_) : data_loader(loader), args(args_)
+LCMMessageIterator::LCMMessageIterator(LCMDataLoader *loader, MessageIteratorArgs args_)
+    : data_loader(loader), args(args_), reader(*loader->log_reader, ITERATOR_WINDOW_SIZE)
 {
-  for (index_pos = 0; index_pos < data_loader->index.size(); index_pos++)
+  transcoder.set_velodyne_calibration(loader->velodyne_calibration);
+  transcoder.set_velodyne_table_mode(loader->point_cloud_config.table_mode);
+  transcoder.point_layout = loader->point_cloud_config.layout;
+  // seek each selected channel to its first event at or after start_time, and merge them by
+  // position in the (timestamp-sorted) index from there.
+  TimeNanos start_time = args.start_time.value_or(0);
+  for (ChannelId channel_id : args.channel_ids)
   {
-    const EventIndex &index = data_loader->index[index_pos];
-    if (index.timestamp_ns < args.start_time)
+    const ChannelSource *source = data_loader->channel_source(channel_id);
+    if (source == nullptr)
+    {
+      continue;
+    }
+    bool duplicate = std::any_of(cursors.begin(), cursors.end(), [&](const ChannelCursor &cursor)
+                                 { return cursor.channel_id == channel_id; });
+    if (duplicate)
     {
       continue;
     }
-    if (index.timestamp_ns > args.end_time)
+    const std::vector<uint32_t> &positions = data_loader->channel_events[source->events];
+    ChannelCursor cursor{
+        .channel_id = channel_id,
+        .source = source,
+        .positions = &positions,
+        .next = data_loader->channel_lower_bound(source->events, start_time),
+        .first_block = 0,
+        .sweep = nullptr,
+        .downsampler = nullptr,
+    };
+    if (source->local && !poses)
     {
-      // did not find any relevant messages, set position to EOF
-      index_pos = data_loader->index.size();
-      return;
+      poses = std::make_unique<PoseTrack>(&data_loader->pose_index, *loader->log_reader, POSE_WINDOW_SIZE);
     }
-    for (uint16_t channel_id : args.channel_ids)
+    if (source->decimated)
     {
-      if (index.channel_id == channel_id)
+      cursor.downsampler = std::make_unique<PointDownsampler>(loader->downsample_config);
+    }
+    if (source->sweep && cursor.next < positions.size())
+    {
+      // The first sweep to end at or after start_time began earlier, so start assembling it from
+      // the previous wrap of the head.
+      SweepBoundary start;
+      find_previous_sweep_wrap(reader, data_loader->index, positions, SweepBoundary{.packet = cursor.next, .block = 0}, &start);
+      cursor.next = start.packet;
+      cursor.first_block = start.block;
+      cursor.sweep = std::make_unique<VelodyneSweep>();
+      if (cursor.downsampler)
       {
-        return;
+        cursor.downsampler->reset();
       }
     }
+    if (cursor.next < positions.size())
+    {
+      pending.push({positions[cursor.next], uint16_t(cursors.size())});
+    }
+    cursors.push_back(std::move(cursor));
+  }
+}
+
+/** Whether the event the iterator reads after the one at `offset`, on `cursor` or on another
+ * selected channel, is close enough after it to be worth reading into the same window. If not, sparse
+ * channels would read a whole window per event only to use one event of it. */
+bool LCMMessageIterator::next_event_in_window(const ChannelCursor &cursor, uint64_t offset) const
+{
+  uint32_t next_pos = UINT32_MAX;
+  if (!pending.empty())
+  {
+    next_pos = pending.top().first;
+  }
+  if (cursor.next + 1 < cursor.positions->size())
+  {
+    next_pos = std::min(next_pos, (*cursor.positions)[cursor.next + 1]);
   }
+  if (next_pos == UINT32_MAX)
+  {
+    return false;
+  }
+  uint64_t next_offset = data_loader->index[next_pos].offset;
+  return next_offset >= offset && next_offset - offset < ITERATOR_WINDOW_SIZE;
 }
 
 /** `next()` returns the next message from the loaded files that matches the arguments provided to
@@ -326,73 +731,84 @@ LCMMessageIterator::LCMMessageIterator(LCMDataLoader *loader, MessageIteratorArg
  */
 std::optional<Result<Message>> LCMMessageIterator::next()
 {
-  for (; index_pos < data_loader->index.size(); index_pos++)
+  while (!pending.empty())
   {
-    EventIndex index = data_loader->index[index_pos];
-    if (index.timestamp_ns > args.end_time)
+    // positions in the index are in timestamp order, so the smallest pending position across all
+    // selected channels is the next message.
+    auto [index_pos, cursor_id] = pending.top();
+    const EventIndex index = data_loader->index[index_pos];
+    if (args.end_time && index.timestamp_ns > *args.end_time)
     {
       return std::nullopt;
     }
-    for (uint16_t channel_id : args.channel_ids)
+    pending.pop();
+    ChannelCursor &cursor = cursors[cursor_id];
+    if (read_event_at(reader, index.offset, &current_event, next_event_in_window(cursor, index.offset)) < 0)
+    {
+      error("failed to parse event at offset", index.offset);
+      return Result<Message>{.error = "failed to parse event"};
+    }
+
+    PointCloudStages stages{
+        .poses = cursor.source->local ? poses.get() : nullptr,
+        .downsampler = cursor.downsampler.get(),
+    };
+    if (cursor.sweep)
     {
-      if (index.channel_id == channel_id)
+      // Sweeps are assembled a packet at a time as the iterator reaches them, and emitted at the
+      // packet where the head wraps around. The rest of that packet starts the next sweep.
+      int32_t wrap = transcoder.add_sweep_blocks(current_event.data, cursor.first_block, cursor.sweep.get(), stages);
+      if (wrap >= 0 && wrap < VELODYNE_BLOCKS_PER_PACKET)
       {
-        const uint8_t *start = data_loader->buffer.data() + index.offset;
-        const size_t remaining = data_loader->buffer.size() - index.offset;
-        if (read_next(start, remaining, &current_event) < 0)
-        {
-          error("failed to parse event at offset", index.offset);
-          return Result<Message>{.error = "failed to parse event"};
-        }
-        else if (index.channel_id == CHANNEL_BROOM_C)
-        {
-          transcoder.transcode_laser_scan(current_event.data, &last_serialized_message, "broom_c");
-        }
-        else if (index.channel_id == CHANNEL_BROOM_L)
-        {
-          transcoder.transcode_laser_scan(current_event.data, &last_serialized_message, "broom_l");
-        }
-        else if (index.channel_id == CHANNEL_BROOM_R)
-        {
-          transcoder.transcode_laser_scan(current_event.data, &last_serialized_message, "broom_r");
-        }
-        else if (index.channel_id == CHANNEL_BROOM_CL)
-        {
-          transcoder.transcode_laser_scan(current_event.data, &last_serialized_message, "broom_cl");
-        }
-        else if (index.channel_id == CHANNEL_BROOM_CR)
-        {
-          transcoder.transcode_laser_scan(current_event.data, &last_serialized_message, "broom_cr");
-        }
-        else if (index.channel_id == CHANNEL_CAM_THUMB_RFC)
-        {
-          transcoder.transcode_image(current_event.data, &last_serialized_message, "cam_thumb_rfc");
-        }
-        else if (index.channel_id == CHANNEL_CAM_THUMB_RFR)
-        {
-          transcoder.transcode_image(current_event.data, &last_serialized_message, "cam_thumb_rfr");
-        }
-        else if (index.channel_id == CHANNEL_VELODYNE)
-        {
-          transcoder.transcode_point_cloud(current_event.data, &last_serialized_message, "velodyne");
-        }
-        else
+        cursor.first_block = wrap;
+        pending.push({index_pos, cursor_id});
+      }
+      else
+      {
+        cursor.first_block = 0;
+        if (++cursor.next < cursor.positions->size())
         {
-          error("unrecognized indexed channel", index.channel_id);
-          return Result<Message>{.error = "unrecognized indexed channel"};
+          pending.push({(*cursor.positions)[cursor.next], cursor_id});
         }
-        index_pos++;
-        return Result<Message>{
-            .value = Message{
-                .channel_id = channel_id,
-                .log_time = index.timestamp_ns,
-                .publish_time = index.timestamp_ns,
-                .data = BytesView{
-                    .ptr = last_serialized_message.data(),
-                    .len = last_serialized_message.size(),
-                }}};
+      }
+      if (wrap < 0)
+      {
+        warn("skipping malformed event at offset", index.offset, "on channel", cursor.channel_id);
+        continue;
+      }
+      if (wrap == VELODYNE_BLOCKS_PER_PACKET)
+      {
+        continue;
+      }
+      transcoder.encode_sweep(*cursor.sweep, &last_serialized_message, cursor.source->frame_id.c_str(), stages);
+      cursor.sweep->clear();
+      if (cursor.downsampler)
+      {
+        cursor.downsampler->reset();
+      }
+    }
+    else
+    {
+      if (++cursor.next < cursor.positions->size())
+      {
+        pending.push({(*cursor.positions)[cursor.next], cursor_id});
+      }
+      const ChannelSource &source = *cursor.source;
+      if (source.transcoder->transcode(transcoder, current_event.data, source.frame_id.c_str(), stages, &last_serialized_message) < 0)
+      {
+        warn("skipping malformed event at offset", index.offset, "on channel", cursor.channel_id);
+        continue;
       }
     }
+    return Result<Message>{
+        .value = Message{
+            .channel_id = cursor.channel_id,
+            .log_time = index.timestamp_ns,
+            .publish_time = index.timestamp_ns,
+            .data = BytesView{
+                .ptr = last_serialized_message.data(),
+                .len = last_serialized_message.size(),
+            }}};
   }
   return std::nullopt;
 }
@@ -0,0 +1,136 @@
+#include "lcm_views.hpp"
+
+#include "lcm/lcmtypes_gps_to_local_t.h"
+#include "lcm/lcmtypes_image_t.h"
+#include "lcm/lcmtypes_laser_t.h"
+#include "lcm/lcmtypes_pose_t.h"
+#include "lcm/lcmtypes_velodyne_t.h"
+
+/** Steps through an encoded message, checking each read against its length. Once a read fails,
+ * `ok` stays false and later reads return zeros. */
+class LcmCursor
+{
+    const uint8_t *buf;
+    size_t len;
+    size_t pos = 0;
+
+public:
+    bool ok = true;
+
+    LcmCursor(const uint8_t *buf, size_t len) : buf(buf), len(len) {}
+
+    template <typename T>
+    T scalar()
+    {
+        if (!ok || len - pos < sizeof(T))
+        {
+            ok = false;
+            return T();
+        }
+        T v = load_be<T>(buf + pos);
+        pos += sizeof(T);
+        return v;
+    }
+
+    template <typename T, size_t N>
+    void fixed_array(T (&out)[N])
+    {
+        for (size_t i = 0; i < N; i++)
+        {
+            out[i] = scalar<T>();
+        }
+    }
+
+    template <typename T>
+    LcmSpan<T> array(int32_t count)
+    {
+        LcmSpan<T> span;
+        if (!ok || count < 0 || size_t(count) > (len - pos) / sizeof(T))
+        {
+            ok = false;
+            return span;
+        }
+        span.data = buf + pos;
+        span.count = count;
+        pos += span.size_bytes();
+        return span;
+    }
+
+    bool fingerprint(int64_t hash) { return scalar<int64_t>() == hash && ok; }
+};
+
+bool view_laser(const uint8_t *buf, size_t len, LaserView *out)
+{
+    LcmCursor cursor(buf, len);
+    if (!cursor.fingerprint(__lcmtypes_laser_t_get_hash()))
+    {
+        return false;
+    }
+    out->utime = cursor.scalar<int64_t>();
+    out->ranges = cursor.array<float>(cursor.scalar<int32_t>());
+    out->intensities = cursor.array<float>(cursor.scalar<int32_t>());
+    out->rad0 = cursor.scalar<float>();
+    out->radstep = cursor.scalar<float>();
+    return cursor.ok;
+}
+
+bool view_velodyne(const uint8_t *buf, size_t len, VelodyneView *out)
+{
+    LcmCursor cursor(buf, len);
+    if (!cursor.fingerprint(__lcmtypes_velodyne_t_get_hash()))
+    {
+        return false;
+    }
+    out->utime = cursor.scalar<int64_t>();
+    out->data = cursor.array<uint8_t>(cursor.scalar<int32_t>());
+    return cursor.ok;
+}
+
+bool view_image(const uint8_t *buf, size_t len, ImageView *out)
+{
+    LcmCursor cursor(buf, len);
+    if (!cursor.fingerprint(__lcmtypes_image_t_get_hash()))
+    {
+        return false;
+    }
+    out->utime = cursor.scalar<int64_t>();
+    out->width = cursor.scalar<int16_t>();
+    out->height = cursor.scalar<int16_t>();
+    out->stride = cursor.scalar<int16_t>();
+    out->pixelformat = cursor.scalar<int32_t>();
+    out->image = cursor.array<uint8_t>(cursor.scalar<int32_t>());
+    return cursor.ok;
+}
+
+bool view_pose(const uint8_t *buf, size_t len, PoseView *out)
+{
+    LcmCursor cursor(buf, len);
+    if (!cursor.fingerprint(__lcmtypes_pose_t_get_hash()))
+    {
+        return false;
+    }
+    out->utime = cursor.scalar<int64_t>();
+    cursor.fixed_array(out->pos);
+    cursor.fixed_array(out->vel);
+    cursor.fixed_array(out->orientation);
+    cursor.fixed_array(out->rotation_rate);
+    cursor.fixed_array(out->accel);
+    return cursor.ok;
+}
+
+bool view_gps_to_local(const uint8_t *buf, size_t len, GpsToLocalView *out)
+{
+    LcmCursor cursor(buf, len);
+    if (!cursor.fingerprint(__lcmtypes_gps_to_local_t_get_hash()))
+    {
+        return false;
+    }
+    out->utime = cursor.scalar<int64_t>();
+    cursor.fixed_array(out->local);
+    cursor.fixed_array(out->lat_lon_el_theta);
+    for (float(&row)[4] : out->gps_cov)
+    {
+        cursor.fixed_array(row);
+    }
+    return cursor.ok;
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/** Reads a big-endian 32-bit value. */
+inline uint32_t load_be32(const uint8_t *p)
+{
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+/** Reads a big-endian 64-bit value. */
+inline uint64_t load_be64(const uint8_t *p)
+{
+    return (uint64_t(load_be32(p)) << 32) | load_be32(p + 4);
+}
+
+/** Reads a big-endian value of an LCM primitive type. */
+template <typename T>
+T load_be(const uint8_t *p)
+{
+    static_assert(sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8);
+    T v;
+    if constexpr (sizeof(T) == 1)
+    {
+        memcpy(&v, p, 1);
+    }
+    else if constexpr (sizeof(T) == 2)
+    {
+        uint16_t bits = uint16_t((p[0] << 8) | p[1]);
+        memcpy(&v, &bits, sizeof(v));
+    }
+    else if constexpr (sizeof(T) == 4)
+    {
+        uint32_t bits = load_be32(p);
+        memcpy(&v, &bits, sizeof(v));
+    }
+    else
+    {
+        uint64_t bits = load_be64(p);
+        memcpy(&v, &bits, sizeof(v));
+    }
+    return v;
+}
+
+inline float load_be_float(const uint8_t *p)
+{
+    return load_be<float>(p);
+}
+
+/** A variable-length array of an encoded LCM message, left where it is in the event. */
+template <typename T>
+struct LcmSpan
+{
+    /** LCM writes every multi-byte value big-endian, so elements are byte-swapped as they are read. */
+    static constexpr bool big_endian = sizeof(T) > 1;
+
+    const uint8_t *data = nullptr;
+    int32_t count = 0;
+
+    T operator[](int32_t i) const { return load_be<T>(data + size_t(i) * sizeof(T)); }
+    size_t size_bytes() const { return size_t(count) * sizeof(T); }
+};
+
+/** An encoded lcmtypes_laser_t. */
+struct LaserView
+{
+    int64_t utime;
+    LcmSpan<float> ranges;
+    LcmSpan<float> intensities;
+    float rad0;
+    float radstep;
+};
+
+/** An encoded lcmtypes_velodyne_t. */
+struct VelodyneView
+{
+    int64_t utime;
+    /** The raw packet. */
+    LcmSpan<uint8_t> data;
+};
+
+/** An encoded lcmtypes_image_t. */
+struct ImageView
+{
+    int64_t utime;
+    int16_t width;
+    int16_t height;
+    int16_t stride;
+    int32_t pixelformat;
+    LcmSpan<uint8_t> image;
+};
+
+/** An encoded lcmtypes_pose_t. It has no variable-length arrays, so every field is decoded. */
+struct PoseView
+{
+    int64_t utime;
+    double pos[3];
+    double vel[3];
+    double orientation[4];
+    double rotation_rate[3];
+    double accel[3];
+};
+
+/** An encoded lcmtypes_gps_to_local_t, decoded like PoseView. */
+struct GpsToLocalView
+{
+    int64_t utime;
+    double local[3];
+    double lat_lon_el_theta[4];
+    float gps_cov[4][4];
+};
+
+/** Read encoded LCM messages in place, as the generated *_decode functions do but without
+ * allocating: fixed-size fields are decoded into the view, and arrays point into `buf`, which must
+ * outlive the view. Each returns false if the fingerprint does not match or the message runs past
+ * `len`. */
+bool view_laser(const uint8_t *buf, size_t len, LaserView *out);
+bool view_velodyne(const uint8_t *buf, size_t len, VelodyneView *out);
+bool view_image(const uint8_t *buf, size_t len, ImageView *out);
+bool view_pose(const uint8_t *buf, size_t len, PoseView *out);
+bool view_gps_to_local(const uint8_t *buf, size_t len, GpsToLocalView *out);
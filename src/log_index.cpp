@@ -0,0 +1,343 @@
+#include "log_index.hpp"
+#include "channel_table.hpp"
+#include "lcm_views.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+const uint8_t LOG_INDEX_MAGIC[8] = {'L', 'C', 'M', 'I', 'N', 'D', 'E', 'X'};
+
+/** Bytes hashed at each end of the log by fingerprint_log(). */
+constexpr size_t FINGERPRINT_SPAN = 64 * 1024;
+
+/** Bytes of the LCM fingerprint at the start of each event payload. */
+constexpr size_t LCM_FINGERPRINT_LEN = 8;
+
+/** Bytes searched per fetch while looking for the next sync word. */
+constexpr size_t RESYNC_CHUNK = 64 * 1024;
+
+uint64_t fingerprint_log(WindowedReader &reader)
+{
+    uint64_t size = reader.size();
+    uint64_t hash = fnv1a(FNV1A_OFFSET_BASIS, reinterpret_cast<const uint8_t *>(&size), sizeof(size));
+    size_t head_len = size_t(std::min<uint64_t>(size, FINGERPRINT_SPAN));
+    hash = fnv1a(hash, reader.fetch(0, head_len), head_len);
+    hash = fnv1a(hash, reader.fetch(size - head_len, head_len), head_len);
+    return hash;
+}
+
+/** Returns the length of the event at `pos` if its header is plausible and it lies within the
+ * file, otherwise 0. */
+uint64_t plausible_event_len(WindowedReader &reader, uint64_t pos, LCMEventHeader *header)
+{
+    const uint8_t *buf = reader.fetch(pos, EVENT_HEADER_LEN);
+    if (buf == nullptr || read_header(buf, EVENT_HEADER_LEN, header) <= 0)
+    {
+        return 0;
+    }
+    if (header->channel_len == 0 || header->channel_len > MAX_CHANNEL_LEN)
+    {
+        return 0;
+    }
+    uint64_t event_len = EVENT_HEADER_LEN + uint64_t(header->channel_len) + header->data_len;
+    if (event_len > reader.size() - pos)
+    {
+        return 0;
+    }
+    return event_len;
+}
+
+/** Returns the offset of the next plausible event after `pos`, or the file size if there is none. */
+uint64_t resync(WindowedReader &reader, uint64_t pos)
+{
+    LCMEventHeader header;
+    uint64_t candidate = pos + 1;
+    while (candidate + EVENT_HEADER_LEN <= reader.size())
+    {
+        size_t len = size_t(std::min<uint64_t>(RESYNC_CHUNK, reader.size() - candidate));
+        size_t found = find_sync_word(reader.fetch(candidate, len), len);
+        if (found == len)
+        {
+            // the sync word may straddle the end of this chunk
+            candidate += len - 3;
+            continue;
+        }
+        candidate += found;
+        if (plausible_event_len(reader, candidate, &header) > 0)
+        {
+            return candidate;
+        }
+        candidate++;
+    }
+    return reader.size();
+}
+
+int64_t scan_log(WindowedReader &reader, LogIndex *index)
+{
+    index->file_size = reader.size();
+    index->content_hash = fingerprint_log(reader);
+    index->channels.clear();
+    index->events.clear();
+    index->skipped.clear();
+
+    ChannelTable channel_table;
+    LCMEventHeader header;
+    uint64_t pos = 0;
+    while (pos < reader.size())
+    {
+        uint64_t event_len = plausible_event_len(reader, pos, &header);
+        if (event_len == 0)
+        {
+            uint64_t next = resync(reader, pos);
+            index->skipped.push_back(SkippedRange{.start = pos, .end = next});
+            pos = next;
+            continue;
+        }
+        // The channel name and the fingerprint after it are read from the same window.
+        size_t fingerprint_len = header.data_len >= LCM_FINGERPRINT_LEN ? LCM_FINGERPRINT_LEN : 0;
+        const uint8_t *name_and_fingerprint = reader.fetch(pos + EVENT_HEADER_LEN, header.channel_len + fingerprint_len);
+        std::string_view event_channel(reinterpret_cast<const char *>(name_and_fingerprint), header.channel_len);
+        int64_t fingerprint = fingerprint_len > 0 ? int64_t(load_be64(name_and_fingerprint + header.channel_len)) : 0;
+        uint64_t timestamp_ns = header.timestamp_us * 1000;
+
+        int32_t channel_pos = channel_table.find(event_channel, fingerprint);
+        if (channel_pos < 0)
+        {
+            // ids must fit in a uint16_t, and deserialize_log_index accepts no more channels.
+            if (channel_table.size() >= UINT16_MAX)
+            {
+                return MALFORMED_EVENT;
+            }
+            channel_pos = int32_t(channel_table.insert(event_channel, fingerprint));
+            index->channels.push_back(IndexedChannel{
+                .topic = std::string(event_channel),
+                .fingerprint = fingerprint,
+                .message_count = 0,
+                .start_time_ns = timestamp_ns,
+                .end_time_ns = timestamp_ns,
+            });
+        }
+        IndexedChannel &channel = index->channels[channel_pos];
+        channel.message_count++;
+        channel.start_time_ns = std::min(channel.start_time_ns, timestamp_ns);
+        channel.end_time_ns = std::max(channel.end_time_ns, timestamp_ns);
+        index->events.push_back(EventIndex{
+            .offset = pos,
+            .channel_id = uint16_t(channel_pos),
+            .schema_id = 0,
+            .timestamp_ns = timestamp_ns,
+        });
+        pos += event_len;
+    }
+    return 0;
+}
+
+size_t events_lower_bound(const std::vector<EventIndex> &events, const std::vector<uint32_t> &positions, uint64_t time_ns)
+{
+    auto it = std::lower_bound(positions.begin(), positions.end(), time_ns, [&events](uint32_t pos, uint64_t t)
+                               { return events[pos].timestamp_ns < t; });
+    return size_t(it - positions.begin());
+}
+
+size_t events_upper_bound(const std::vector<EventIndex> &events, const std::vector<uint32_t> &positions, uint64_t time_ns)
+{
+    auto it = std::upper_bound(positions.begin(), positions.end(), time_ns, [&events](uint64_t t, uint32_t pos)
+                               { return t < events[pos].timestamp_ns; });
+    return size_t(it - positions.begin());
+}
+
+// Serialized indexes are little-endian. Event offsets and timestamps are stored as varint deltas
+// from the previous event, which keeps a typical entry to around five bytes.
+
+void put_u64(std::vector<uint8_t> &out, uint64_t v)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        out.push_back(uint8_t(v >> (8 * i)));
+    }
+}
+
+void put_varint(std::vector<uint8_t> &out, uint64_t v)
+{
+    while (v >= 0x80)
+    {
+        out.push_back(uint8_t(v) | 0x80);
+        v >>= 7;
+    }
+    out.push_back(uint8_t(v));
+}
+
+struct IndexCursor
+{
+    const uint8_t *buf;
+    size_t len;
+    size_t pos;
+    bool ok;
+
+    uint64_t u64()
+    {
+        if (len - pos < 8)
+        {
+            ok = false;
+            return 0;
+        }
+        uint64_t v = 0;
+        for (int i = 0; i < 8; i++)
+        {
+            v |= uint64_t(buf[pos + i]) << (8 * i);
+        }
+        pos += 8;
+        return v;
+    }
+
+    uint64_t varint()
+    {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            if (pos == len)
+            {
+                break;
+            }
+            uint8_t b = buf[pos++];
+            v |= uint64_t(b & 0x7f) << shift;
+            if (!(b & 0x80))
+            {
+                return v;
+            }
+        }
+        ok = false;
+        return 0;
+    }
+};
+
+std::vector<uint8_t> serialize_log_index(const LogIndex &index)
+{
+    std::vector<uint8_t> out(LOG_INDEX_MAGIC, LOG_INDEX_MAGIC + sizeof(LOG_INDEX_MAGIC));
+    out.reserve(128 + index.events.size() * 5);
+    put_varint(out, LOG_INDEX_VERSION);
+    put_u64(out, index.file_size);
+    put_u64(out, uint64_t(index.file_mtime_ns));
+    put_u64(out, index.content_hash);
+
+    put_varint(out, index.channels.size());
+    for (const IndexedChannel &channel : index.channels)
+    {
+        put_varint(out, channel.topic.size());
+        out.insert(out.end(), channel.topic.begin(), channel.topic.end());
+        put_u64(out, uint64_t(channel.fingerprint));
+        put_varint(out, channel.message_count);
+        put_u64(out, channel.start_time_ns);
+        put_u64(out, channel.end_time_ns);
+    }
+
+    put_varint(out, index.skipped.size());
+    for (const SkippedRange &range : index.skipped)
+    {
+        put_varint(out, range.start);
+        put_varint(out, range.end - range.start);
+    }
+
+    put_varint(out, index.events.size());
+    uint64_t prev_offset = 0;
+    int64_t prev_timestamp_us = 0;
+    for (const EventIndex &event : index.events)
+    {
+        int64_t timestamp_us = int64_t(event.timestamp_ns / 1000);
+        int64_t delta = timestamp_us - prev_timestamp_us;
+        put_varint(out, event.offset - prev_offset);
+        put_varint(out, event.channel_id);
+        // zigzag, since timestamps are not guaranteed to be monotonic
+        put_varint(out, (uint64_t(delta) << 1) ^ uint64_t(delta >> 63));
+        prev_offset = event.offset;
+        prev_timestamp_us = timestamp_us;
+    }
+    return out;
+}
+
+bool deserialize_log_index(const uint8_t *buf, size_t len, LogIndex *index)
+{
+    if (buf == nullptr || len < sizeof(LOG_INDEX_MAGIC) || memcmp(buf, LOG_INDEX_MAGIC, sizeof(LOG_INDEX_MAGIC)) != 0)
+    {
+        return false;
+    }
+    IndexCursor cursor{.buf = buf, .len = len, .pos = sizeof(LOG_INDEX_MAGIC), .ok = true};
+    if (cursor.varint() != LOG_INDEX_VERSION)
+    {
+        return false;
+    }
+    index->file_size = cursor.u64();
+    index->file_mtime_ns = int64_t(cursor.u64());
+    index->content_hash = cursor.u64();
+
+    uint64_t channel_count = cursor.varint();
+    if (!cursor.ok || channel_count > UINT16_MAX)
+    {
+        return false;
+    }
+    index->channels.resize(channel_count);
+    for (IndexedChannel &channel : index->channels)
+    {
+        uint64_t topic_len = cursor.varint();
+        if (!cursor.ok || topic_len > len - cursor.pos)
+        {
+            return false;
+        }
+        channel.topic.assign(reinterpret_cast<const char *>(buf + cursor.pos), topic_len);
+        cursor.pos += topic_len;
+        channel.fingerprint = int64_t(cursor.u64());
+        channel.message_count = cursor.varint();
+        channel.start_time_ns = cursor.u64();
+        channel.end_time_ns = cursor.u64();
+    }
+
+    uint64_t skipped_count = cursor.varint();
+    if (!cursor.ok || skipped_count > (len - cursor.pos) / 2)
+    {
+        return false;
+    }
+    index->skipped.resize(skipped_count);
+    for (SkippedRange &range : index->skipped)
+    {
+        range.start = cursor.varint();
+        range.end = range.start + cursor.varint();
+    }
+
+    uint64_t event_count = cursor.varint();
+    // every event takes at least three bytes
+    if (!cursor.ok || event_count > (len - cursor.pos) / 3)
+    {
+        return false;
+    }
+    index->events.resize(event_count);
+    // the per-channel counts are checked against the events, since the loader sizes buffers by them.
+    std::vector<uint64_t> channel_events(channel_count);
+    uint64_t offset = 0;
+    int64_t timestamp_us = 0;
+    for (EventIndex &event : index->events)
+    {
+        offset += cursor.varint();
+        uint64_t channel_id = cursor.varint();
+        uint64_t zigzag = cursor.varint();
+        timestamp_us += int64_t(zigzag >> 1) ^ -int64_t(zigzag & 1);
+        if (channel_id >= channel_count)
+        {
+            return false;
+        }
+        channel_events[channel_id]++;
+        event = EventIndex{
+            .offset = offset,
+            .channel_id = uint16_t(channel_id),
+            .schema_id = 0,
+            .timestamp_ns = uint64_t(timestamp_us) * 1000,
+        };
+    }
+    for (size_t i = 0; i < channel_count; i++)
+    {
+        if (index->channels[i].message_count != channel_events[i])
+        {
+            return false;
+        }
+    }
+    return cursor.ok;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "event_log.hpp"
+
+/** Bumped whenever the layout of a serialized LogIndex changes. */
+constexpr uint32_t LOG_INDEX_VERSION = 3;
+
+/** Sidecar index files live next to the log, with this suffix appended to its name. */
+constexpr const char *LOG_INDEX_SUFFIX = ".idx";
+
+struct EventIndex
+{
+    uint64_t offset;
+    uint16_t channel_id;
+    uint16_t schema_id;
+    uint64_t timestamp_ns;
+};
+
+/** The events on one channel name that carry one LCM type. */
+struct IndexedChannel
+{
+    std::string topic;
+    /** The 8-byte LCM fingerprint that starts each event's payload, which identifies its type. 0
+     * for events too short to hold one. */
+    int64_t fingerprint;
+    uint64_t message_count;
+    uint64_t start_time_ns;
+    uint64_t end_time_ns;
+};
+
+/** A byte range [start, end) of the log that could not be decoded and was skipped over. */
+struct SkippedRange
+{
+    uint64_t start;
+    uint64_t end;
+};
+
+/** Everything needed to iterate over a log without scanning it. `events` are in file order and
+ * their `channel_id` is a position in `channels`.
+ */
+struct LogIndex
+{
+    /** Fingerprint of the log this index was built from. */
+    uint64_t file_size;
+    int64_t file_mtime_ns;
+    uint64_t content_hash;
+
+    std::vector<IndexedChannel> channels;
+    std::vector<EventIndex> events;
+    std::vector<SkippedRange> skipped;
+};
+
+/** Hashes the file size and the bytes at the head and tail of the log. The host does not expose
+ * modification times to the loader, so this is what it uses to detect a stale index.
+ */
+uint64_t fingerprint_log(WindowedReader &reader);
+
+/** Reads every event header and payload fingerprint in the log, recording its offset, channel and
+ * timestamp. Events are grouped into channels by name and fingerprint. Corrupt or
+ * truncated regions are recorded in `skipped`, and scanning resumes at the next sync word. Returns
+ * 0 on success or a negative error code from event_log.hpp. Sets `file_size` and `content_hash`.
+ */
+int64_t scan_log(WindowedReader &reader, LogIndex *index);
+
+/** Returns the position in `positions`, which are positions in `events` sorted by timestamp, of the
+ * first event at or after `time_ns`. */
+size_t events_lower_bound(const std::vector<EventIndex> &events, const std::vector<uint32_t> &positions, uint64_t time_ns);
+
+/** As events_lower_bound, but returns the position of the first event after `time_ns`. */
+size_t events_upper_bound(const std::vector<EventIndex> &events, const std::vector<uint32_t> &positions, uint64_t time_ns);
+
+std::vector<uint8_t> serialize_log_index(const LogIndex &index);
+
+/** Returns false if `buf` does not hold a complete, self-consistent index of the current version. */
+bool deserialize_log_index(const uint8_t *buf, size_t len, LogIndex *index);
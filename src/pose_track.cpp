@@ -0,0 +1,119 @@
+#include "pose_track.hpp"
+
+#include "lcm_views.hpp"
+#include "lcm/rotations.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+void interpolate_pose(const VehiclePose &a, const VehiclePose &b, int64_t utime, VehiclePose *out)
+{
+    double t = 0;
+    if (b.utime > a.utime)
+    {
+        t = std::clamp(double(utime - a.utime) / double(b.utime - a.utime), 0.0, 1.0);
+    }
+    out->utime = utime;
+    for (int i = 0; i < 3; i++)
+    {
+        out->pos[i] = a.pos[i] + (b.pos[i] - a.pos[i]) * t;
+    }
+
+    double dot = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        dot += a.orientation[i] * b.orientation[i];
+    }
+    // q and -q are the same rotation; take the one nearer `a`
+    double sign = dot < 0 ? -1.0 : 1.0;
+    dot = std::min(std::fabs(dot), 1.0);
+    double wa = 1 - t;
+    double wb = t;
+    double angle = std::acos(dot);
+    // poses a few milliseconds apart are almost always close enough that normalized linear
+    // interpolation is indistinguishable from slerp
+    if (angle > 1e-3)
+    {
+        wa = std::sin(wa * angle) / std::sin(angle);
+        wb = std::sin(wb * angle) / std::sin(angle);
+    }
+    double norm = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        out->orientation[i] = wa * a.orientation[i] + wb * sign * b.orientation[i];
+        norm += out->orientation[i] * out->orientation[i];
+    }
+    norm = std::sqrt(norm);
+    for (int i = 0; i < 4; i++)
+    {
+        out->orientation[i] /= norm;
+    }
+}
+
+void pose_to_matrix(const VehiclePose &pose, double m[16])
+{
+    rot_quat_pos_to_matrix(pose.orientation, pose.pos, m);
+}
+
+PoseTrack::PoseTrack(const PoseIndex *index, foxglove_data_loader::Reader reader, size_t window_size)
+    : index(index), reader(reader, window_size)
+{
+}
+
+bool PoseTrack::read_pose(size_t pos, VehiclePose *pose)
+{
+    if (read_event_at(reader, index->offsets[pos], &event) < 0)
+    {
+        return false;
+    }
+    PoseView msg;
+    if (!view_pose(event.data.ptr, event.data.len, &msg))
+    {
+        return false;
+    }
+    pose->utime = msg.utime;
+    memcpy(pose->pos, msg.pos, sizeof(pose->pos));
+    memcpy(pose->orientation, msg.orientation, sizeof(pose->orientation));
+    return true;
+}
+
+bool PoseTrack::pose_at(int64_t utime, VehiclePose *pose)
+{
+    const std::vector<int64_t> &utimes = index->utimes;
+    if (utimes.empty())
+    {
+        return false;
+    }
+    bool in_bracket = bracket != SIZE_MAX &&
+                      (bracket == 0 || utimes[bracket] <= utime) &&
+                      (bracket + 1 == utimes.size() || utime < utimes[bracket + 1]);
+    if (!in_bracket)
+    {
+        size_t next = size_t(std::upper_bound(utimes.begin(), utimes.end(), utime) - utimes.begin());
+        size_t found = next == 0 ? 0 : next - 1;
+        if (bracket != SIZE_MAX && found == bracket + 1)
+        {
+            // moving on to the next pair of poses, which shares a pose with this one
+            before = after;
+        }
+        else if (!read_pose(found, &before))
+        {
+            bracket = SIZE_MAX;
+            return false;
+        }
+        if (found + 1 < utimes.size() && !read_pose(found + 1, &after))
+        {
+            bracket = SIZE_MAX;
+            return false;
+        }
+        bracket = found;
+    }
+    if (bracket + 1 == utimes.size())
+    {
+        *pose = before;
+        return true;
+    }
+    interpolate_pose(before, after, utime, pose);
+    return true;
+}
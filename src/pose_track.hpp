@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "event_log.hpp"
+
+/** The LCM channel carrying the pose of the vehicle body in the local frame. */
+constexpr const char *POSE_CHANNEL = "POSE";
+
+/** Position and orientation quaternion (w, x, y, z) of the vehicle body in the local frame. */
+struct VehiclePose
+{
+    int64_t utime;
+    double pos[3];
+    double orientation[4];
+};
+
+/** The POSE events of a log, in order of their log times (in microseconds). Lookups by time search
+ * the log times, which are taken to be close to the utimes in the poses themselves. */
+struct PoseIndex
+{
+    std::vector<int64_t> utimes;
+    std::vector<uint64_t> offsets;
+};
+
+/** The pose at `utime` on the way from `a` to `b`: position is interpolated linearly and
+ * orientation along the shortest arc. Times outside [a.utime, b.utime] are clamped to it. */
+void interpolate_pose(const VehiclePose &a, const VehiclePose &b, int64_t utime, VehiclePose *out);
+
+/** Writes the row-major body-to-local transform of `pose` into `m`. */
+void pose_to_matrix(const VehiclePose &pose, double m[16]);
+
+/** Looks up the vehicle pose at arbitrary times, reading POSE events from the log on demand.
+ *
+ * Lookups binary-search the index for the POSE events on either side of the requested time, and
+ * keep those two poses so that the many lookups between one POSE event and the next read nothing.
+ */
+class PoseTrack
+{
+    const PoseIndex *index;
+    WindowedReader reader;
+    LCMEvent event;
+    /** Position in `index` of `before`. `after` holds the pose after it, if there is one. */
+    size_t bracket = SIZE_MAX;
+    VehiclePose before;
+    VehiclePose after;
+
+    bool read_pose(size_t pos, VehiclePose *pose);
+
+public:
+    PoseTrack(const PoseIndex *index, foxglove_data_loader::Reader reader, size_t window_size);
+
+    /** Sets `pose` to the pose at `utime`, interpolated between the POSE events on either side and
+     * clamped to the first and last. Returns false if there are none, or one cannot be read. */
+    bool pose_at(int64_t utime, VehiclePose *pose);
+};
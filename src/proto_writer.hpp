@@ -0,0 +1,215 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+/** Writes protobuf wire format straight into a caller-provided buffer. Used for messages that are
+ * encoded often enough that building foxglove::schemas structs and going through an Arena would
+ * dominate the cost of transcoding.
+ *
+ * Messages are written by function templates that take either a ProtoSizer or a ProtoWriter, so
+ * the same code first measures the exact encoded size and then writes it in a single pass.
+ */
+
+enum ProtoWireType : uint32_t
+{
+    WIRE_VARINT = 0,
+    WIRE_I64 = 1,
+    WIRE_LEN = 2,
+    WIRE_I32 = 5,
+};
+
+constexpr size_t varint_size(uint64_t v)
+{
+    size_t n = 1;
+    while (v >= 0x80)
+    {
+        v >>= 7;
+        n++;
+    }
+    return n;
+}
+
+/** Counts the bytes that a ProtoWriter would write for the same sequence of calls. */
+class ProtoSizer
+{
+    size_t len = 0;
+
+public:
+    size_t size() const { return len; }
+
+    void tag(uint32_t field, ProtoWireType type) { len += varint_size((field << 3) | type); }
+    void varint(uint64_t v) { len += varint_size(v); }
+    void raw(const void *, size_t n) { len += n; }
+
+    void varint_field(uint32_t field, uint64_t v)
+    {
+        tag(field, WIRE_VARINT);
+        varint(v);
+    }
+    void fixed32_field(uint32_t field, uint32_t)
+    {
+        tag(field, WIRE_I32);
+        len += 4;
+    }
+    void double_field(uint32_t field, double)
+    {
+        tag(field, WIRE_I64);
+        len += 8;
+    }
+    void bytes_field(uint32_t field, const void *, size_t n)
+    {
+        tag(field, WIRE_LEN);
+        varint(n);
+        len += n;
+    }
+    void string_field(uint32_t field, std::string_view s) { bytes_field(field, s.data(), s.size()); }
+
+    /** Reserves a length-delimited field of `n` bytes whose contents are written later. */
+    uint8_t *len_field(uint32_t field, size_t n)
+    {
+        bytes_field(field, nullptr, n);
+        return nullptr;
+    }
+
+    template <typename F>
+    void message_field(uint32_t field, F &&body)
+    {
+        ProtoSizer inner;
+        body(inner);
+        bytes_field(field, nullptr, inner.size());
+    }
+};
+
+/** Writes protobuf fields into a buffer that the caller has already sized with a ProtoSizer. */
+class ProtoWriter
+{
+    uint8_t *cursor;
+
+public:
+    explicit ProtoWriter(uint8_t *buf) : cursor(buf) {}
+
+    uint8_t *position() const { return cursor; }
+
+    void tag(uint32_t field, ProtoWireType type) { varint((field << 3) | type); }
+    void varint(uint64_t v)
+    {
+        while (v >= 0x80)
+        {
+            *cursor++ = uint8_t(v) | 0x80;
+            v >>= 7;
+        }
+        *cursor++ = uint8_t(v);
+    }
+    void raw(const void *data, size_t n)
+    {
+        if (n > 0)
+        {
+            memcpy(cursor, data, n);
+        }
+        cursor += n;
+    }
+
+    void varint_field(uint32_t field, uint64_t v)
+    {
+        tag(field, WIRE_VARINT);
+        varint(v);
+    }
+    void fixed32_field(uint32_t field, uint32_t v)
+    {
+        tag(field, WIRE_I32);
+        for (int i = 0; i < 4; i++)
+        {
+            *cursor++ = uint8_t(v >> (8 * i));
+        }
+    }
+    void double_field(uint32_t field, double v)
+    {
+        uint64_t bits;
+        memcpy(&bits, &v, sizeof(bits));
+        tag(field, WIRE_I64);
+        for (int i = 0; i < 8; i++)
+        {
+            *cursor++ = uint8_t(bits >> (8 * i));
+        }
+    }
+    void bytes_field(uint32_t field, const void *data, size_t n)
+    {
+        tag(field, WIRE_LEN);
+        varint(n);
+        raw(data, n);
+    }
+    void string_field(uint32_t field, std::string_view s) { bytes_field(field, s.data(), s.size()); }
+
+    /** Writes the tag and length of a field of `n` bytes and returns where its contents go. */
+    uint8_t *len_field(uint32_t field, size_t n)
+    {
+        tag(field, WIRE_LEN);
+        varint(n);
+        uint8_t *body = cursor;
+        cursor += n;
+        return body;
+    }
+
+    template <typename F>
+    void message_field(uint32_t field, F &&body)
+    {
+        ProtoSizer inner;
+        body(inner);
+        tag(field, WIRE_LEN);
+        varint(inner.size());
+        body(*this);
+    }
+};
+
+/** google.protobuf.Timestamp from LCM microseconds. */
+template <typename Sink>
+void write_timestamp(Sink &sink, uint32_t field, int64_t utime)
+{
+    sink.message_field(field, [utime](auto &ts)
+                       {
+                           ts.varint_field(1, uint64_t(utime / 1000000));
+                           ts.varint_field(2, uint64_t((utime % 1000000) * 1000));
+                       });
+}
+
+/** foxglove.Pose at the origin with identity orientation. */
+template <typename Sink>
+void write_identity_pose(Sink &sink, uint32_t field)
+{
+    sink.message_field(field, [](auto &pose)
+                       {
+                           pose.message_field(2, [](auto &orientation)
+                                              { orientation.double_field(4, 1.0); });
+                       });
+}
+
+/** foxglove.Pose from a position and an LCM orientation quaternion, which is stored w, x, y, z. */
+template <typename Sink>
+void write_pose(Sink &sink, uint32_t field, const double pos[3], const double wxyz[4])
+{
+    sink.message_field(field, [pos, wxyz](auto &pose)
+                       {
+                           pose.message_field(1, [pos](auto &position)
+                                              {
+                                                  for (uint32_t i = 0; i < 3; i++)
+                                                  {
+                                                      if (pos[i] != 0)
+                                                      {
+                                                          position.double_field(i + 1, pos[i]);
+                                                      }
+                                                  }
+                                              });
+                           pose.message_field(2, [wxyz](auto &orientation)
+                                              {
+                                                  for (uint32_t i = 0; i < 4; i++)
+                                                  {
+                                                      double v = wxyz[(i + 1) % 4];
+                                                      if (v != 0)
+                                                      {
+                                                          orientation.double_field(i + 1, v);
+                                                      }
+                                                  }
+                                              });
+                       });
+}
@@ -1,112 +1,532 @@
 #include "transcode.hpp"
 
-#include "lcm/lcmtypes_velodyne_t.h"
-#include "lcm/lcmtypes_laser_t.h"
+#include "lcm/config.h"
 #include "lcm/velodyne.h"
-#include "lcm/lcmtypes_image_t.h"
+#include "laser_batch.hpp"
+#include "lcm_views.hpp"
+#include "proto_writer.hpp"
+#include "lcm/small_linalg.h"
 
-#include <foxglove/schemas.hpp>
+#include <algorithm>
+#include <cstring>
+#include <utility>
 
 Transcoder::Transcoder()
 {
-    velodyne_calibration = velodyne_calib_create();
+    set_velodyne_calibration(default_velodyne_calibration());
 }
 
-Transcoder::~Transcoder()
+void Transcoder::set_velodyne_calibration(std::shared_ptr<const VelodyneCalibration> calib)
 {
-    free(velodyne_calibration);
+    if (velodyne_lasers && calib == velodyne_calibration)
+    {
+        return;
+    }
+    velodyne_calibration = std::move(calib);
+    velodyne_lasers = shared_laser_table(&velodyne_calibration->lasers, velodyne_table_mode);
+}
+
+void Transcoder::set_velodyne_table_mode(VelodyneTableMode mode)
+{
+    if (velodyne_lasers && mode == velodyne_table_mode)
+    {
+        return;
+    }
+    velodyne_table_mode = mode;
+    velodyne_lasers = shared_laser_table(&velodyne_calibration->lasers, mode);
+}
+
+/** Lidar returns closer than this are dropped from point clouds. */
+constexpr double VELODYNE_MIN_RANGE = 0.01;
+
+constexpr uint32_t POINT_CLOUD_TIMESTAMP = 1;
+constexpr uint32_t POINT_CLOUD_FRAME_ID = 2;
+constexpr uint32_t POINT_CLOUD_POSE = 3;
+constexpr uint32_t POINT_CLOUD_POINT_STRIDE = 4;
+constexpr uint32_t POINT_CLOUD_FIELDS = 5;
+constexpr uint32_t POINT_CLOUD_DATA = 6;
+
+constexpr uint32_t PACKED_ELEMENT_FIELD_NAME = 1;
+constexpr uint32_t PACKED_ELEMENT_FIELD_OFFSET = 2;
+constexpr uint32_t PACKED_ELEMENT_FIELD_TYPE = 3;
+
+/** Values of foxglove.PackedElementField.NumericType. */
+enum class NumericType : uint64_t
+{
+    UINT8 = 1,
+    UINT16 = 3,
+    FLOAT32 = 7,
+    FLOAT64 = 8,
+};
+
+template <typename Sink>
+void write_packed_element_field(Sink &sink, std::string_view name, uint32_t offset, NumericType type)
+{
+    sink.message_field(POINT_CLOUD_FIELDS, [&](auto &field)
+                       {
+                           field.string_field(PACKED_ELEMENT_FIELD_NAME, name);
+                           field.fixed32_field(PACKED_ELEMENT_FIELD_OFFSET, offset);
+                           field.varint_field(PACKED_ELEMENT_FIELD_TYPE, uint64_t(type));
+                       });
+}
+
+size_t point_stride(PointLayout layout)
+{
+    switch (layout)
+    {
+    case PointLayout::XYZI_F64:
+        return 32;
+    case PointLayout::XYZI_F32:
+        return 13;
+    case PointLayout::XYZIRA_F32:
+        return 16;
+    }
+    return 0;
+}
+
+bool load_point_cloud_config(const uint8_t *buf, size_t len, const std::string &path, PointCloudConfig *out,
+                             std::string *error)
+{
+    Config *config = parse_config(buf, len, path, error);
+    if (config == nullptr)
+    {
+        return false;
+    }
+    PointCloudConfig result = *out;
+    char *layout = nullptr;
+    char *tables = nullptr;
+    bool ok = true;
+    if (config_get_str(config, "pointcloud.layout", &layout) == 0)
+    {
+        if (strcmp(layout, "xyzi_f32") == 0)
+        {
+            result.layout = PointLayout::XYZI_F32;
+        }
+        else if (strcmp(layout, "xyzi_f64") == 0)
+        {
+            result.layout = PointLayout::XYZI_F64;
+        }
+        else if (strcmp(layout, "xyzira_f32") == 0)
+        {
+            result.layout = PointLayout::XYZIRA_F32;
+        }
+        else
+        {
+            *error = std::string("unknown pointcloud.layout ") + layout;
+            ok = false;
+        }
+    }
+    if (ok && config_get_str(config, "pointcloud.tables", &tables) == 0)
+    {
+        if (strcmp(tables, "none") == 0)
+        {
+            result.table_mode = VelodyneTableMode::NONE;
+        }
+        else if (strcmp(tables, "azimuth") == 0)
+        {
+            result.table_mode = VelodyneTableMode::AZIMUTH;
+        }
+        else if (strcmp(tables, "full") == 0)
+        {
+            result.table_mode = VelodyneTableMode::FULL;
+        }
+        else
+        {
+            *error = std::string("unknown pointcloud.tables ") + tables;
+            ok = false;
+        }
+    }
+    config_free(config);
+    if (ok)
+    {
+        *out = result;
+    }
+    return ok;
+}
+
+template <typename Sink>
+void write_point_cloud_header(Sink &sink, std::string_view frame_id, PointLayout layout)
+{
+    sink.string_field(POINT_CLOUD_FRAME_ID, frame_id);
+    write_identity_pose(sink, POINT_CLOUD_POSE);
+    sink.fixed32_field(POINT_CLOUD_POINT_STRIDE, uint32_t(point_stride(layout)));
+    switch (layout)
+    {
+    case PointLayout::XYZI_F64:
+        write_packed_element_field(sink, "x", 0, NumericType::FLOAT64);
+        write_packed_element_field(sink, "y", 8, NumericType::FLOAT64);
+        write_packed_element_field(sink, "z", 16, NumericType::FLOAT64);
+        write_packed_element_field(sink, "intensity", 24, NumericType::FLOAT64);
+        break;
+    case PointLayout::XYZI_F32:
+    case PointLayout::XYZIRA_F32:
+        write_packed_element_field(sink, "x", 0, NumericType::FLOAT32);
+        write_packed_element_field(sink, "y", 4, NumericType::FLOAT32);
+        write_packed_element_field(sink, "z", 8, NumericType::FLOAT32);
+        write_packed_element_field(sink, "intensity", 12, NumericType::UINT8);
+        if (layout == PointLayout::XYZIRA_F32)
+        {
+            write_packed_element_field(sink, "ring", 13, NumericType::UINT8);
+            write_packed_element_field(sink, "azimuth", 14, NumericType::UINT16);
+        }
+        break;
+    }
+}
+
+constexpr uint32_t LASER_SCAN_TIMESTAMP = 1;
+constexpr uint32_t LASER_SCAN_FRAME_ID = 2;
+constexpr uint32_t LASER_SCAN_POSE = 3;
+constexpr uint32_t LASER_SCAN_START_ANGLE = 4;
+constexpr uint32_t LASER_SCAN_END_ANGLE = 5;
+constexpr uint32_t LASER_SCAN_RANGES = 6;
+constexpr uint32_t LASER_SCAN_INTENSITIES = 7;
+
+/** Writes everything but the contents of the ranges and intensities, and returns where they go. */
+template <typename Sink>
+std::pair<uint8_t *, uint8_t *> write_laser_scan(Sink &sink, const LaserView &laser, std::string_view frame_id)
+{
+    write_timestamp(sink, LASER_SCAN_TIMESTAMP, laser.utime);
+    sink.string_field(LASER_SCAN_FRAME_ID, frame_id);
+    write_identity_pose(sink, LASER_SCAN_POSE);
+    // angles are summed in float, as the laser reported them
+    double start_angle = laser.rad0;
+    double end_angle = laser.rad0 + laser.radstep * float(laser.ranges.count);
+    if (start_angle != 0)
+    {
+        sink.double_field(LASER_SCAN_START_ANGLE, start_angle);
+    }
+    if (end_angle != 0)
+    {
+        sink.double_field(LASER_SCAN_END_ANGLE, end_angle);
+    }
+    uint8_t *ranges = nullptr;
+    uint8_t *intensities = nullptr;
+    if (laser.ranges.count > 0)
+    {
+        ranges = sink.len_field(LASER_SCAN_RANGES, size_t(laser.ranges.count) * sizeof(double));
+    }
+    if (laser.intensities.count > 0)
+    {
+        intensities = sink.len_field(LASER_SCAN_INTENSITIES, size_t(laser.intensities.count) * sizeof(double));
+    }
+    return {ranges, intensities};
+}
+
+constexpr uint32_t COMPRESSED_IMAGE_TIMESTAMP = 1;
+constexpr uint32_t COMPRESSED_IMAGE_DATA = 2;
+constexpr uint32_t COMPRESSED_IMAGE_FORMAT = 3;
+constexpr uint32_t COMPRESSED_IMAGE_FRAME_ID = 4;
+
+/** Writes everything but the contents of the image data, and returns where they go. */
+template <typename Sink>
+uint8_t *write_compressed_image(Sink &sink, int64_t utime, std::string_view frame_id, size_t data_len)
+{
+    write_timestamp(sink, COMPRESSED_IMAGE_TIMESTAMP, utime);
+    uint8_t *data = sink.len_field(COMPRESSED_IMAGE_DATA, data_len);
+    sink.string_field(COMPRESSED_IMAGE_FORMAT, "jpeg");
+    sink.string_field(COMPRESSED_IMAGE_FRAME_ID, frame_id);
+    return data;
 }
 
-template <typename T>
-foxglove::FoxgloveError encode_to_vec(T &msg, std::vector<uint8_t> *out)
+constexpr uint32_t POSE_IN_FRAME_TIMESTAMP = 1;
+constexpr uint32_t POSE_IN_FRAME_FRAME_ID = 2;
+constexpr uint32_t POSE_IN_FRAME_POSE = 3;
+
+template <typename Sink>
+void write_pose_in_frame(Sink &sink, const PoseView &pose, std::string_view frame_id)
+{
+    write_timestamp(sink, POSE_IN_FRAME_TIMESTAMP, pose.utime);
+    sink.string_field(POSE_IN_FRAME_FRAME_ID, frame_id);
+    write_pose(sink, POSE_IN_FRAME_POSE, pose.pos, pose.orientation);
+}
+
+constexpr uint32_t LOCATION_FIX_LATITUDE = 1;
+constexpr uint32_t LOCATION_FIX_LONGITUDE = 2;
+constexpr uint32_t LOCATION_FIX_ALTITUDE = 3;
+constexpr uint32_t LOCATION_FIX_TIMESTAMP = 6;
+constexpr uint32_t LOCATION_FIX_FRAME_ID = 7;
+
+/** Writes a LocationFix with an unknown covariance. gps_cov is not in the ENU frame that
+ * LocationFix expects, so it is left out. */
+template <typename Sink>
+void write_location_fix(Sink &sink, const GpsToLocalView &gps, std::string_view frame_id)
+{
+    write_timestamp(sink, LOCATION_FIX_TIMESTAMP, gps.utime);
+    sink.string_field(LOCATION_FIX_FRAME_ID, frame_id);
+    sink.double_field(LOCATION_FIX_LATITUDE, gps.lat_lon_el_theta[0]);
+    sink.double_field(LOCATION_FIX_LONGITUDE, gps.lat_lon_el_theta[1]);
+    sink.double_field(LOCATION_FIX_ALTITUDE, gps.lat_lon_el_theta[2]);
+}
+
+/** Writes everything but the contents of the point data, and returns where they go. */
+template <typename Sink>
+uint8_t *write_point_cloud(Sink &sink, int64_t utime, const std::vector<uint8_t> &header, size_t data_len)
+{
+    write_timestamp(sink, POINT_CLOUD_TIMESTAMP, utime);
+    sink.raw(header.data(), header.size());
+    return sink.len_field(POINT_CLOUD_DATA, data_len);
+}
+
+void Transcoder::build_point_cloud_header(const char *frame_id)
 {
-    size_t encoded_len = 0;
-    foxglove::FoxgloveError error = msg.encode(out->data(), out->size(), &encoded_len);
-    out->resize(encoded_len);
-    if (error == foxglove::FoxgloveError::BufferTooShort)
+    if (!point_cloud_header.empty() && point_cloud_frame_id == frame_id && point_cloud_layout == point_layout)
     {
-        error = msg.encode(out->data(), out->size(), &encoded_len);
+        return;
     }
-    return error;
+    ProtoSizer sizer;
+    write_point_cloud_header(sizer, frame_id, point_layout);
+    point_cloud_header.resize(sizer.size());
+    ProtoWriter writer(point_cloud_header.data());
+    write_point_cloud_header(writer, frame_id, point_layout);
+    point_cloud_frame_id = frame_id;
+    point_cloud_layout = point_layout;
 }
 
-int32_t Transcoder::transcode_point_cloud(const std::vector<uint8_t> &in, std::vector<uint8_t> *out, const char *frame_id)
+/** Writes the points of blocks [first_block, end_block) of a decoded packet into `out` in
+ * `layout`. */
+void write_points(const VelodynePacketPoints &points, int32_t first_block, int32_t end_block, PointLayout layout, uint8_t *out)
 {
-    foxglove::schemas::PointCloud pointcloud;
-    pointcloud.fields.push_back(foxglove::schemas::PackedElementField{.name = "x", .offset = 0, .type = foxglove::schemas::PackedElementField::NumericType::FLOAT64});
-    pointcloud.fields.push_back(foxglove::schemas::PackedElementField{.name = "y", .offset = 8, .type = foxglove::schemas::PackedElementField::NumericType::FLOAT64});
-    pointcloud.fields.push_back(foxglove::schemas::PackedElementField{.name = "z", .offset = 16, .type = foxglove::schemas::PackedElementField::NumericType::FLOAT64});
-    pointcloud.fields.push_back(foxglove::schemas::PackedElementField{.name = "intensity", .offset = 24, .type = foxglove::schemas::PackedElementField::NumericType::FLOAT64});
-    pointcloud.frame_id = frame_id;
-    pointcloud.point_stride = 32;
-    pointcloud.pose = foxglove::schemas::Pose{
-        .orientation = foxglove::schemas::Quaternion{.w = 1},
-    };
+    for (int32_t block = first_block; block < end_block; block++)
+    {
+        uint16_t azimuth = uint16_t(points.azimuth[block]);
+        for (int32_t i = points.block_start[block]; i < points.block_start[block + 1]; i++)
+        {
+            if (layout == PointLayout::XYZI_F64)
+            {
+                double point[4] = {points.x[i], points.y[i], points.z[i], points.intensity[i] / 255.0};
+                memcpy(out, point, sizeof(point));
+                out += sizeof(point);
+                continue;
+            }
+            float xyz[3] = {float(points.x[i]), float(points.y[i]), float(points.z[i])};
+            memcpy(out, xyz, sizeof(xyz));
+            out[12] = points.intensity[i];
+            if (layout == PointLayout::XYZIRA_F32)
+            {
+                out[13] = points.ring[i];
+                memcpy(out + 14, &azimuth, sizeof(azimuth));
+            }
+            out += point_stride(layout);
+        }
+    }
+}
 
-    lcmtypes_velodyne_t vel;
-    lcmtypes_velodyne_t_decode(in.data(), 0, in.size(), &vel);
-    pointcloud.timestamp.emplace(foxglove::schemas::Timestamp{.sec = uint32_t(vel.utime) / 1000000, .nsec = (uint32_t(vel.utime) % 1000000) * 1000});
-    // parse the velodyne data packet
-    velodyne_decoder_t vdecoder;
-    velodyne_decoder_init(velodyne_calibration, &vdecoder, vel.data, vel.datalen);
-    velodyne_sample_t vsample;
+/** Microseconds for the head to turn through one raw azimuth step. */
+constexpr double VELODYNE_USEC_PER_AZIMUTH = 1e6 / VELODYNE_ROTATION_HZ / VELODYNE_AZIMUTHS;
 
-    while (!velodyne_decoder_next(velodyne_calibration, &vdecoder, &vsample))
+/** Projects blocks [first_block, end_block) of `velodyne_points`, decoded from a packet stamped
+ * `utime`, into the local frame. */
+bool Transcoder::project_to_local(PoseTrack &poses, int64_t utime, int32_t first_block, int32_t end_block)
+{
+    if (velodyne_points.blocks == 0)
+    {
+        return true;
+    }
+    // A packet is stamped when it is sent, just after its last block was fired. Earlier blocks are
+    // dated back by how far the head has turned since.
+    int32_t last_azimuth = velodyne_points.azimuth[velodyne_points.blocks - 1];
+    int64_t transform_utime = 0;
+    double sensor_to_local[16];
+    for (int32_t block = first_block; block < end_block; block++)
     {
-        if (vsample.range < 0.01)
+        int32_t behind = (last_azimuth - velodyne_points.azimuth[block] + VELODYNE_AZIMUTHS) % VELODYNE_AZIMUTHS;
+        int64_t block_utime = utime - int64_t(behind * VELODYNE_USEC_PER_AZIMUTH);
+        // upper and lower blocks are fired together, so each transform serves two blocks
+        if (block == first_block || block_utime != transform_utime)
         {
-            continue;
+            VehiclePose pose;
+            if (!poses.pose_at(block_utime, &pose))
+            {
+                return false;
+            }
+            double body_to_local[16];
+            pose_to_matrix(pose, body_to_local);
+            matrix_multiply_4x4_4x4(body_to_local, velodyne_calibration->sensor_to_body, sensor_to_local);
+            transform_utime = block_utime;
         }
-        constexpr size_t size = sizeof(double) * 3;
-        std::byte bytes[size];
-        std::memcpy(bytes, &vsample.xyz, size);
-        pointcloud.data.insert(pointcloud.data.end(), bytes, bytes + size);
+        velodyne_transform_points(sensor_to_local, velodyne_points.block_start[block], velodyne_points.block_start[block + 1],
+                                  &velodyne_points);
+    }
+    return true;
+}
+
+int32_t Transcoder::transcode_point_cloud(const VelodyneView &vel, std::vector<uint8_t> *out, const char *frame_id,
+                                          const PointCloudStages &stages)
+{
+    build_point_cloud_header(frame_id);
+
+    // Decode the whole packet first so that the message can be sized exactly.
+    int32_t num_points = velodyne_decode_packet(*velodyne_lasers, vel.data.data, vel.data.size_bytes(), VELODYNE_MIN_RANGE, &velodyne_points);
+    if (num_points < 0)
+    {
+        return -1;
+    }
+    int64_t utime = vel.utime;
+    if (stages.poses != nullptr && !project_to_local(*stages.poses, utime, 0, velodyne_points.blocks))
+    {
+        return -1;
+    }
+    size_t stride = point_stride(point_layout);
+    int32_t max_points = 0;
+    if (stages.downsampler != nullptr)
+    {
+        stages.downsampler->reset();
+        stages.downsampler->filter(&velodyne_points, 0, velodyne_points.blocks);
+        num_points = velodyne_points.block_start[velodyne_points.blocks];
+        max_points = stages.downsampler->settings().max_points;
+    }
+    size_t count = size_t(num_points);
+    size_t kept = points_within_budget(count, max_points);
+    ProtoSizer sizer;
+    write_point_cloud(sizer, utime, point_cloud_header, kept * stride);
+    out->resize(sizer.size());
+    ProtoWriter writer(out->data());
+    uint8_t *data = write_point_cloud(writer, utime, point_cloud_header, kept * stride);
+    if (kept == count)
+    {
+        write_points(velodyne_points, 0, velodyne_points.blocks, point_layout, data);
+    }
+    else
+    {
+        budget_points.resize(count * stride);
+        write_points(velodyne_points, 0, velodyne_points.blocks, point_layout, budget_points.data());
+        copy_within_budget(budget_points.data(), count, stride, max_points, data);
     }
-    encode_to_vec(pointcloud, out);
-    lcmtypes_velodyne_t_decode_cleanup(&vel);
     return 0;
 }
 
-int32_t Transcoder::transcode_laser_scan(const std::vector<uint8_t> &in, std::vector<uint8_t> *out, const char *frame_id)
+void VelodyneSweep::clear()
+{
+    points.clear();
+    last_azimuth = -1;
+    blocks = 0;
+}
+
+int32_t velodyne_block_azimuths(foxglove_data_loader::BytesView in, int32_t azimuths[VELODYNE_BLOCKS_PER_PACKET])
 {
-    lcmtypes_laser_t msg;
-    lcmtypes_laser_t_decode(in.data(), 0, in.size(), &msg);
-    foxglove::schemas::LaserScan scan;
-    scan.timestamp.emplace(foxglove::schemas::Timestamp{.sec = uint32_t(msg.utime) / 1000000, .nsec = (uint32_t(msg.utime) % 1000000) * 1000});
-    scan.frame_id = frame_id;
-    scan.pose = foxglove::schemas::Pose{
-        .orientation = foxglove::schemas::Quaternion{.w = 1},
-    };
-    scan.start_angle = msg.rad0;
-    scan.end_angle = msg.rad0 + msg.radstep * msg.nranges;
-    std::vector<double> ranges(msg.nranges);
-    for (int i = 0; i < msg.nranges; i++)
+    VelodyneView vel;
+    if (!view_velodyne(in.ptr, in.len, &vel))
     {
-        ranges[i] = msg.ranges[i];
+        return -1;
     }
-    std::vector<double> intensities(msg.nintensities);
-    for (int i = 0; i < msg.nintensities; i++)
+    int32_t blocks = -1;
+    if (vel.data.size_bytes() == VELODYNE_PACKET_LEN)
     {
-        intensities[i] = msg.intensities[i];
+        for (blocks = 0; blocks < VELODYNE_BLOCKS_PER_PACKET; blocks++)
+        {
+            const uint8_t *block = vel.data.data + blocks * 100;
+            uint16_t magic = uint16_t(block[0] | (block[1] << 8));
+            if (magic != 0xeeff && magic != 0xddff)
+            {
+                break;
+            }
+            azimuths[blocks] = block[2] | (block[3] << 8);
+        }
+    }
+    return blocks;
+}
+
+int32_t Transcoder::add_sweep_blocks(foxglove_data_loader::BytesView in, int32_t first_block, VelodyneSweep *sweep,
+                                     const PointCloudStages &stages)
+{
+    VelodyneView vel;
+    if (!view_velodyne(in.ptr, in.len, &vel))
+    {
+        return -1;
+    }
+    int32_t num_points = velodyne_decode_packet(*velodyne_lasers, vel.data.data, vel.data.size_bytes(), VELODYNE_MIN_RANGE, &velodyne_points);
+    sweep->utime = vel.utime;
+    if (num_points < 0)
+    {
+        return -1;
+    }
+
+    first_block = std::min(first_block, velodyne_points.blocks);
+    int32_t block = first_block;
+    for (; block < velodyne_points.blocks; block++)
+    {
+        int32_t azimuth = velodyne_points.azimuth[block];
+        if (velodyne_wrapped(sweep->last_azimuth, azimuth) ||
+            sweep->blocks == VELODYNE_MAX_SWEEP_PACKETS * VELODYNE_BLOCKS_PER_PACKET)
+        {
+            break;
+        }
+        sweep->last_azimuth = azimuth;
+        sweep->blocks++;
+    }
+    if (stages.poses != nullptr && !project_to_local(*stages.poses, sweep->utime, first_block, block))
+    {
+        return -1;
+    }
+    if (stages.downsampler != nullptr)
+    {
+        stages.downsampler->filter(&velodyne_points, first_block, block);
     }
-    scan.ranges = ranges;
-    scan.intensities = intensities;
-    encode_to_vec(scan, out);
-    lcmtypes_laser_t_decode_cleanup(&msg);
+    int32_t added = velodyne_points.block_start[block] - velodyne_points.block_start[first_block];
+    size_t len = sweep->points.size();
+    sweep->points.resize(len + added * point_stride(point_layout));
+    write_points(velodyne_points, first_block, block, point_layout, sweep->points.data() + len);
+    return block < velodyne_points.blocks ? block : VELODYNE_BLOCKS_PER_PACKET;
+}
+
+int32_t Transcoder::encode_sweep(const VelodyneSweep &sweep, std::vector<uint8_t> *out, const char *frame_id,
+                                 const PointCloudStages &stages)
+{
+    build_point_cloud_header(frame_id);
+    size_t stride = point_stride(point_layout);
+    size_t count = sweep.points.size() / stride;
+    int32_t max_points = stages.downsampler != nullptr ? stages.downsampler->settings().max_points : 0;
+    size_t data_len = points_within_budget(count, max_points) * stride;
+    ProtoSizer sizer;
+    write_point_cloud(sizer, sweep.utime, point_cloud_header, data_len);
+    out->resize(sizer.size());
+    ProtoWriter writer(out->data());
+    uint8_t *data = write_point_cloud(writer, sweep.utime, point_cloud_header, data_len);
+    copy_within_budget(sweep.points.data(), count, stride, max_points, data);
     return 0;
 }
-int32_t Transcoder::transcode_image(const std::vector<uint8_t> &in, std::vector<uint8_t> *out, const char *frame_id)
-{
-    lcmtypes_image_t msg;
-    lcmtypes_image_t_decode(in.data(), 0, in.size(), &msg);
-    foxglove::schemas::CompressedImage img;
-    uint32_t usec = uint32_t(msg.utime);
-    img.timestamp.emplace(foxglove::schemas::Timestamp{.sec = usec / 1000000, .nsec = (usec % 1000000) * 1000});
-    img.frame_id = frame_id;
-    const std::byte* ptr = (const std::byte*)msg.image;
-    img.data.insert(img.data.end(), ptr, ptr + msg.size);
-    img.format = "jpeg";
-    encode_to_vec(img, out);
-    lcmtypes_image_t_decode_cleanup(&msg);
+
+int32_t Transcoder::transcode_laser_scan(const LaserView &laser, std::vector<uint8_t> *out, const char *frame_id)
+{
+    // The float arrays are widened straight from the event into the message's packed fields.
+    ProtoSizer sizer;
+    write_laser_scan(sizer, laser, frame_id);
+    out->resize(sizer.size());
+    ProtoWriter writer(out->data());
+    auto [ranges, intensities] = write_laser_scan(writer, laser, frame_id);
+    widen_be_floats(laser.ranges.data, laser.ranges.count, ranges);
+    widen_be_floats(laser.intensities.data, laser.intensities.count, intensities);
+    return 0;
+}
+
+int32_t Transcoder::transcode_image(const ImageView &image, std::vector<uint8_t> *out, const char *frame_id)
+{
+    // The JPEG is copied once, from the event straight into the message.
+    ProtoSizer sizer;
+    write_compressed_image(sizer, image.utime, frame_id, image.image.size_bytes());
+    out->resize(sizer.size());
+    ProtoWriter writer(out->data());
+    uint8_t *data = write_compressed_image(writer, image.utime, frame_id, image.image.size_bytes());
+    memcpy(data, image.image.data, image.image.size_bytes());
+    return 0;
+}
+
+int32_t Transcoder::transcode_pose(const PoseView &pose, std::vector<uint8_t> *out, const char *frame_id)
+{
+    ProtoSizer sizer;
+    write_pose_in_frame(sizer, pose, frame_id);
+    out->resize(sizer.size());
+    ProtoWriter writer(out->data());
+    write_pose_in_frame(writer, pose, frame_id);
+    return 0;
+}
+
+int32_t Transcoder::transcode_location_fix(const GpsToLocalView &gps, std::vector<uint8_t> *out, const char *frame_id)
+{
+    ProtoSizer sizer;
+    write_location_fix(sizer, gps, frame_id);
+    out->resize(sizer.size());
+    ProtoWriter writer(out->data());
+    write_location_fix(writer, gps, frame_id);
     return 0;
 }
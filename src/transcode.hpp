@@ -1,15 +1,136 @@
 #pragma once
 #include <vector>
 #include <memory>
+#include <string>
+#include "foxglove_data_loader/data_loader.hpp"
 #include "lcm/velodyne.h"
+#include "velodyne_batch.hpp"
+#include "velodyne_calib.hpp"
+#include "pose_track.hpp"
+#include "downsample.hpp"
+#include "lcm_views.hpp"
+
+/** Layout of each point in the Velodyne point clouds. */
+enum class PointLayout
+{
+    /** float64 x, y, z and intensity in [0, 1]: 32 bytes */
+    XYZI_F64,
+    /** float32 x, y, z and uint8 intensity: 13 bytes */
+    XYZI_F32,
+    /** float32 x, y, z, uint8 intensity, uint8 ring (logical laser number) and uint16 azimuth in
+     * hundredths of a degree: 16 bytes */
+    XYZIRA_F32,
+};
+
+/** Bytes per point in `layout`. */
+size_t point_stride(PointLayout layout);
+
+/** How Velodyne points are decoded and written into point clouds. */
+struct PointCloudConfig
+{
+    PointLayout layout = PointLayout::XYZI_F32;
+    VelodyneTableMode table_mode = VelodyneTableMode::AZIMUTH;
+};
+
+/** Reads `pointcloud.{layout,tables}` from a file in the format of lcm/config.c, keeping the
+ * defaults for keys that are absent. `layout` is one of "xyzi_f32", "xyzi_f64" or "xyzira_f32", and
+ * `tables` one of "none", "azimuth" or "full". Returns false and sets `error` if the file cannot be
+ * parsed or a value is invalid.
+ */
+bool load_point_cloud_config(const uint8_t *buf, size_t len, const std::string &path, PointCloudConfig *config,
+                             std::string *error);
+
+/** Head rotation rate assumed when dating the blocks of a packet: the HDL-64E default of 600 rpm. */
+constexpr double VELODYNE_ROTATION_HZ = 10;
+
+/** Longest sweep assembled, in packets, in case the head stops spinning. */
+constexpr int32_t VELODYNE_MAX_SWEEP_PACKETS = 1024;
+
+/** A point cloud assembled from consecutive Velodyne packets, covering one revolution of the
+ * sensor head. A revolution ends at the first block whose azimuth is more than half a turn below
+ * that of the block before it, so one packet may contribute blocks to two sweeps.
+ */
+struct VelodyneSweep
+{
+    /** Point data of the blocks added so far. */
+    std::vector<uint8_t> points;
+    /** Raw azimuth of the last block added, or -1 if the sweep is empty. */
+    int32_t last_azimuth = -1;
+    int32_t blocks = 0;
+    /** utime of the last packet added. */
+    int64_t utime = 0;
+
+    void clear();
+};
+
+/** Returns whether the head wrapped around between blocks with raw azimuths `prev` and `next`. */
+inline bool velodyne_wrapped(int32_t prev, int32_t next)
+{
+    return prev >= 0 && next >= 0 && prev - next > 18000;
+}
+
+/** Reads the raw azimuth (hundredths of a degree) of each block of a VELODYNE event. Returns the
+ * number of blocks, or -1 if the event does not hold a Velodyne packet.
+ */
+int32_t velodyne_block_azimuths(foxglove_data_loader::BytesView in, int32_t azimuths[VELODYNE_BLOCKS_PER_PACKET]);
+
+/** Optional stages that Velodyne points pass through between decoding and encoding. */
+struct PointCloudStages
+{
+    /** If set, each block is projected into the local frame with the vehicle pose at the time it
+     * was fired. */
+    PoseTrack *poses = nullptr;
+    /** If set, points are dropped by the downsampler and messages are held to its budget. */
+    PointDownsampler *downsampler = nullptr;
+};
 
 struct Transcoder
 {
-    velodyne_calib_t *velodyne_calibration;
+    std::shared_ptr<const VelodyneCalibration> velodyne_calibration;
+    std::shared_ptr<const VelodyneLaserTable> velodyne_lasers;
+    VelodyneTableMode velodyne_table_mode = VelodyneTableMode::AZIMUTH;
+    /** Scratch space for the packet being decoded. */
+    VelodynePacketPoints velodyne_points;
+    /** Scratch space for points that are over a downsampling budget. */
+    std::vector<uint8_t> budget_points;
+    /** Layout of the points in transcoded clouds. Changing it in the middle of a sweep is not
+     * supported. */
+    PointLayout point_layout = PointLayout::XYZI_F32;
+
+    /** The encoded PointCloud fields that are the same for every message in a channel (frame_id,
+     * pose, point_stride and fields), built for `point_cloud_frame_id` and `point_cloud_layout`.
+     */
+    std::vector<uint8_t> point_cloud_header;
+    std::string point_cloud_frame_id;
+    PointLayout point_cloud_layout = PointLayout::XYZI_F32;
 
     Transcoder();
-    ~Transcoder();
-    int32_t transcode_point_cloud(const std::vector<uint8_t> &in, std::vector<uint8_t> *out, const char *frame_id);
-    int32_t transcode_laser_scan(const std::vector<uint8_t> &in, std::vector<uint8_t> *out, const char *frame_id);
-    int32_t transcode_image(const std::vector<uint8_t> &in, std::vector<uint8_t> *out, const char *frame_id);
+    /** Decodes Velodyne packets with `calib` from now on. The compiled-in calibration by default. */
+    void set_velodyne_calibration(std::shared_ptr<const VelodyneCalibration> calib);
+    /** Rebuilds (or shares) the Velodyne decoding tables in `mode`. AZIMUTH by default. */
+    void set_velodyne_table_mode(VelodyneTableMode mode);
+    /** Transcodes a Velodyne packet through `stages`. Returns -1 if the packet is malformed or a block
+     * has no pose. */
+    int32_t transcode_point_cloud(const VelodyneView &vel, std::vector<uint8_t> *out, const char *frame_id,
+                                  const PointCloudStages &stages);
+    /** Decodes the blocks of a VELODYNE event from `first_block` on into `sweep` through `stages`,
+     * stopping at the block where the sweep ends. Returns that block, VELODYNE_BLOCKS_PER_PACKET if
+     * the sweep continues into the next packet, or -1 if the event does not hold a Velodyne packet
+     * or there is no pose. The caller resets the downsampler between sweeps.
+     */
+    int32_t add_sweep_blocks(foxglove_data_loader::BytesView in, int32_t first_block, VelodyneSweep *sweep,
+                             const PointCloudStages &stages);
+    /** Encodes `sweep`, held to the budget of `stages.downsampler` if there is one. */
+    int32_t encode_sweep(const VelodyneSweep &sweep, std::vector<uint8_t> *out, const char *frame_id,
+                         const PointCloudStages &stages);
+    int32_t transcode_laser_scan(const LaserView &laser, std::vector<uint8_t> *out, const char *frame_id);
+    int32_t transcode_image(const ImageView &image, std::vector<uint8_t> *out, const char *frame_id);
+    /** Transcodes a pose_t into a PoseInFrame. */
+    int32_t transcode_pose(const PoseView &pose, std::vector<uint8_t> *out, const char *frame_id);
+    /** Transcodes a gps_to_local_t into a LocationFix. */
+    int32_t transcode_location_fix(const GpsToLocalView &gps, std::vector<uint8_t> *out, const char *frame_id);
+
+private:
+    void build_point_cloud_header(const char *frame_id);
+    bool project_to_local(PoseTrack &poses, int64_t utime, int32_t first_block, int32_t end_block);
 };
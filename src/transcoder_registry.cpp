@@ -0,0 +1,192 @@
+#include "transcoder_registry.hpp"
+#include "lcm_views.hpp"
+
+#include "lcm/lcmtypes_gps_to_local_t.h"
+#include "lcm/lcmtypes_image_t.h"
+#include "lcm/lcmtypes_laser_t.h"
+#include "lcm/lcmtypes_pose_t.h"
+#include "lcm/lcmtypes_velodyne_t.h"
+
+#include <foxglove/schemas.hpp>
+
+// Each traits struct names, for one LCM type:
+//   View, view()   the in-place view and the function that fills it from an event
+//   fingerprint()  the type's __lcmtypes_*_get_hash()
+//   SCHEMA_ID, schema()  the Foxglove schema of its messages
+//   FRAME          the FramePolicy of its channels
+//   VELODYNE       whether its channels get sweep, local-frame and decimated channels
+//   transcode()    writes a message from a view
+
+struct ImageTraits
+{
+    using View = ImageView;
+    static constexpr const char *LCM_TYPE = "lcmtypes.image_t";
+    static int64_t fingerprint() { return __lcmtypes_image_t_get_hash(); }
+    static bool view(const uint8_t *buf, size_t len, View *out) { return view_image(buf, len, out); }
+    static constexpr uint16_t SCHEMA_ID = SCHEMA_COMPRESSED_IMAGE;
+    static foxglove::Schema schema() { return foxglove::schemas::CompressedImage::schema(); }
+    static constexpr FramePolicy FRAME = FramePolicy::CHANNEL_NAME;
+    static constexpr bool VELODYNE = false;
+    static int32_t transcode(Transcoder &transcoder, const View &view, const char *frame_id, const PointCloudStages &,
+                             std::vector<uint8_t> *out)
+    {
+        return transcoder.transcode_image(view, out, frame_id);
+    }
+};
+
+struct LaserTraits
+{
+    using View = LaserView;
+    static constexpr const char *LCM_TYPE = "lcmtypes.laser_t";
+    static int64_t fingerprint() { return __lcmtypes_laser_t_get_hash(); }
+    static bool view(const uint8_t *buf, size_t len, View *out) { return view_laser(buf, len, out); }
+    static constexpr uint16_t SCHEMA_ID = SCHEMA_LASER_SCAN;
+    static foxglove::Schema schema() { return foxglove::schemas::LaserScan::schema(); }
+    static constexpr FramePolicy FRAME = FramePolicy::CHANNEL_NAME;
+    static constexpr bool VELODYNE = false;
+    static int32_t transcode(Transcoder &transcoder, const View &view, const char *frame_id, const PointCloudStages &,
+                             std::vector<uint8_t> *out)
+    {
+        return transcoder.transcode_laser_scan(view, out, frame_id);
+    }
+};
+
+struct VelodyneTraits
+{
+    using View = VelodyneView;
+    static constexpr const char *LCM_TYPE = "lcmtypes.velodyne_t";
+    static int64_t fingerprint() { return __lcmtypes_velodyne_t_get_hash(); }
+    static bool view(const uint8_t *buf, size_t len, View *out) { return view_velodyne(buf, len, out); }
+    static constexpr uint16_t SCHEMA_ID = SCHEMA_POINT_CLOUD;
+    static foxglove::Schema schema() { return foxglove::schemas::PointCloud::schema(); }
+    static constexpr FramePolicy FRAME = FramePolicy::CHANNEL_NAME;
+    static constexpr bool VELODYNE = true;
+    static int32_t transcode(Transcoder &transcoder, const View &view, const char *frame_id, const PointCloudStages &stages,
+                             std::vector<uint8_t> *out)
+    {
+        return transcoder.transcode_point_cloud(view, out, frame_id, stages);
+    }
+};
+
+struct PoseTraits
+{
+    using View = PoseView;
+    static constexpr const char *LCM_TYPE = "lcmtypes.pose_t";
+    static int64_t fingerprint() { return __lcmtypes_pose_t_get_hash(); }
+    static bool view(const uint8_t *buf, size_t len, View *out) { return view_pose(buf, len, out); }
+    static constexpr uint16_t SCHEMA_ID = SCHEMA_POSE_IN_FRAME;
+    static foxglove::Schema schema() { return foxglove::schemas::PoseInFrame::schema(); }
+    static constexpr FramePolicy FRAME = FramePolicy::LOCAL;
+    static constexpr bool VELODYNE = false;
+    static int32_t transcode(Transcoder &transcoder, const View &view, const char *frame_id, const PointCloudStages &,
+                             std::vector<uint8_t> *out)
+    {
+        return transcoder.transcode_pose(view, out, frame_id);
+    }
+};
+
+struct GpsToLocalTraits
+{
+    using View = GpsToLocalView;
+    static constexpr const char *LCM_TYPE = "lcmtypes.gps_to_local_t";
+    static int64_t fingerprint() { return __lcmtypes_gps_to_local_t_get_hash(); }
+    static bool view(const uint8_t *buf, size_t len, View *out) { return view_gps_to_local(buf, len, out); }
+    static constexpr uint16_t SCHEMA_ID = SCHEMA_LOCATION_FIX;
+    static foxglove::Schema schema() { return foxglove::schemas::LocationFix::schema(); }
+    static constexpr FramePolicy FRAME = FramePolicy::CHANNEL_NAME;
+    static constexpr bool VELODYNE = false;
+    static int32_t transcode(Transcoder &transcoder, const View &view, const char *frame_id, const PointCloudStages &,
+                             std::vector<uint8_t> *out)
+    {
+        return transcoder.transcode_location_fix(view, out, frame_id);
+    }
+};
+
+template <typename Traits>
+int32_t transcode_with(Transcoder &transcoder, foxglove_data_loader::BytesView in, const char *frame_id,
+                       const PointCloudStages &stages, std::vector<uint8_t> *out)
+{
+    typename Traits::View view;
+    if (!Traits::view(in.ptr, in.len, &view))
+    {
+        return -1;
+    }
+    return Traits::transcode(transcoder, view, frame_id, stages, out);
+}
+
+template <typename Traits>
+constexpr TranscoderEntry entry_for()
+{
+    return TranscoderEntry{
+        .lcm_type = Traits::LCM_TYPE,
+        .fingerprint = &Traits::fingerprint,
+        .schema_id = Traits::SCHEMA_ID,
+        .schema = &Traits::schema,
+        .frame_policy = Traits::FRAME,
+        .velodyne = Traits::VELODYNE,
+        .transcode = &transcode_with<Traits>,
+    };
+}
+
+extern const TranscoderEntry TRANSCODERS[] = {
+    entry_for<ImageTraits>(),
+    entry_for<LaserTraits>(),
+    entry_for<VelodyneTraits>(),
+    entry_for<PoseTraits>(),
+    entry_for<GpsToLocalTraits>(),
+};
+
+extern const size_t TRANSCODER_COUNT = sizeof(TRANSCODERS) / sizeof(TRANSCODERS[0]);
+
+/** Slots in the fingerprint table. A power of two at least twice the number of transcoders. */
+constexpr size_t TRANSCODER_SLOTS = 16;
+static_assert(sizeof(TRANSCODERS) / sizeof(TRANSCODERS[0]) * 2 <= TRANSCODER_SLOTS);
+
+struct TranscoderSlot
+{
+    int64_t fingerprint;
+    const TranscoderEntry *entry;
+};
+
+struct TranscoderTable
+{
+    TranscoderSlot slots[TRANSCODER_SLOTS] = {};
+
+    TranscoderTable()
+    {
+        for (size_t i = 0; i < TRANSCODER_COUNT; i++)
+        {
+            insert(&TRANSCODERS[i]);
+        }
+    }
+
+    static size_t slot_of(int64_t fingerprint) { return size_t(uint64_t(fingerprint) >> 32) & (TRANSCODER_SLOTS - 1); }
+
+    void insert(const TranscoderEntry *entry)
+    {
+        int64_t fingerprint = entry->fingerprint();
+        size_t i = slot_of(fingerprint);
+        while (slots[i].entry != nullptr)
+        {
+            i = (i + 1) & (TRANSCODER_SLOTS - 1);
+        }
+        slots[i] = TranscoderSlot{.fingerprint = fingerprint, .entry = entry};
+    }
+
+    const TranscoderEntry *find(int64_t fingerprint) const
+    {
+        for (size_t i = slot_of(fingerprint);; i = (i + 1) & (TRANSCODER_SLOTS - 1))
+        {
+            if (slots[i].entry == nullptr || slots[i].fingerprint == fingerprint)
+            {
+                return slots[i].entry;
+            }
+        }
+    }
+};
+
+const TranscoderEntry *find_transcoder(int64_t fingerprint)
+{
+    static const TranscoderTable table;
+    return table.find(fingerprint);
+}
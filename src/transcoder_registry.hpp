@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "transcode.hpp"
+#include <foxglove/schema.hpp>
+
+constexpr uint16_t SCHEMA_COMPRESSED_IMAGE = 1;
+constexpr uint16_t SCHEMA_POINT_CLOUD = 2;
+constexpr uint16_t SCHEMA_LASER_SCAN = 3;
+constexpr uint16_t SCHEMA_POSE_IN_FRAME = 4;
+constexpr uint16_t SCHEMA_LOCATION_FIX = 5;
+
+/** Frame of poses and of point clouds projected with the vehicle's pose. */
+constexpr const char *LOCAL_FRAME_ID = "local";
+
+/** How the frame id of a channel's messages is chosen. */
+enum class FramePolicy
+{
+    /** The channel name in lower case, like "broom_c". */
+    CHANNEL_NAME,
+    /** LOCAL_FRAME_ID. */
+    LOCAL,
+};
+
+/** Decodes an event in place and writes its message into `out`. Returns -1 if the event does not
+ * hold the entry's type or cannot be transcoded. `stages` only apply to point clouds. */
+using TranscodeFn = int32_t (*)(Transcoder &transcoder, foxglove_data_loader::BytesView in, const char *frame_id,
+                                const PointCloudStages &stages, std::vector<uint8_t> *out);
+
+/** How the events of one LCM type become messages.
+ *
+ * Entries are generated from a traits struct for each type in transcoder_registry.cpp, which names
+ * the type's in-place view, its fingerprint, its Foxglove schema and its frame policy. To support a
+ * new type, add a view for it to lcm_views.hpp, a Transcoder method that writes its message from
+ * the view, and a traits struct listed in the registry. Channels carrying it are then discovered
+ * and advertised without changes to the loader.
+ */
+struct TranscoderEntry
+{
+    /** The LCM type's name, like "lcmtypes.laser_t". */
+    const char *lcm_type;
+    int64_t (*fingerprint)();
+    uint16_t schema_id;
+    foxglove::Schema (*schema)();
+    FramePolicy frame_policy;
+    /** Whether channels of this type also get sweep, local-frame and decimated channels. */
+    bool velodyne;
+    TranscodeFn transcode;
+};
+
+/** Every registered transcoder. */
+extern const TranscoderEntry TRANSCODERS[];
+extern const size_t TRANSCODER_COUNT;
+
+/** Returns the transcoder for events whose fingerprint is `fingerprint`, or nullptr if there is
+ * none. Entries are found with one probe sequence in a small open-addressing table keyed by the
+ * fingerprint, which is built the first time this is called. */
+const TranscoderEntry *find_transcoder(int64_t fingerprint);
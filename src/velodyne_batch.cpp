@@ -0,0 +1,288 @@
+#include "velodyne_batch.hpp"
+#include "cache_mutex.hpp"
+#include "channel_table.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+constexpr uint16_t UPPER_MAGIC = 0xeeff;
+constexpr uint16_t LOWER_MAGIC = 0xddff;
+constexpr double RADIANS_PER_LSB = 0.00017453293;
+constexpr double TWO_PI = 2 * 3.14159265358979323846;
+constexpr double METERS_PER_LSB = 0.002;
+
+/** The head angle at raw azimuth `azimuth`, as computed by velodyne_decoder_next. */
+double head_angle(int32_t azimuth)
+{
+    double ctheta = TWO_PI - azimuth * RADIANS_PER_LSB;
+    return ctheta == TWO_PI ? 0 : ctheta;
+}
+
+void build_laser_table(const velodyne_calib_t *calib, VelodyneTableMode mode, VelodyneLaserTable *table)
+{
+    for (int i = 0; i < VELODYNE_NUM_LASERS; i++)
+    {
+        const velodyne_laser_calib &laser = calib->lasers[i];
+        table->range_offset[i] = laser.range_offset;
+        table->range_scale[i] = 1.0 + laser.range_scale_offset;
+        table->sin_rcf[i] = sin(laser.rcf);
+        table->cos_rcf[i] = cos(laser.rcf);
+        table->sin_vcf[i] = calib->sincos[i][0];
+        table->cos_vcf[i] = calib->sincos[i][1];
+        table->hcf[i] = laser.hcf;
+        table->logical[i] = uint8_t(calib->physical2logical[i]);
+    }
+
+    table->mode = mode;
+    table->azimuth_sincos.clear();
+    table->directions.clear();
+    if (mode == VelodyneTableMode::NONE)
+    {
+        return;
+    }
+    table->azimuth_sincos.resize(2 * VELODYNE_AZIMUTHS);
+    for (int32_t azimuth = 0; azimuth < VELODYNE_AZIMUTHS; azimuth++)
+    {
+        table->azimuth_sincos[2 * azimuth] = sin(head_angle(azimuth));
+        table->azimuth_sincos[2 * azimuth + 1] = cos(head_angle(azimuth));
+    }
+    if (mode != VelodyneTableMode::FULL)
+    {
+        return;
+    }
+    table->directions.resize(size_t(2) * VELODYNE_AZIMUTHS * VELODYNE_NUM_LASERS);
+    float *direction = table->directions.data();
+    for (int32_t azimuth = 0; azimuth < VELODYNE_AZIMUTHS; azimuth++)
+    {
+        double sin_ctheta = table->azimuth_sincos[2 * azimuth];
+        double cos_ctheta = table->azimuth_sincos[2 * azimuth + 1];
+        for (int l = 0; l < VELODYNE_NUM_LASERS; l++)
+        {
+            double sin_theta = sin_ctheta * table->cos_rcf[l] + cos_ctheta * table->sin_rcf[l];
+            double cos_theta = cos_ctheta * table->cos_rcf[l] - sin_ctheta * table->sin_rcf[l];
+            *direction++ = float(table->cos_vcf[l] * cos_theta);
+            *direction++ = float(table->cos_vcf[l] * sin_theta);
+        }
+    }
+}
+
+std::shared_ptr<const VelodyneLaserTable> shared_laser_table(const velodyne_calib_t *calib, VelodyneTableMode mode)
+{
+    struct CachedTable
+    {
+        uint64_t hash;
+        VelodyneTableMode mode;
+        /** Compared on a hash match, so that a collision cannot hand out the wrong table. */
+        velodyne_calib_t calib;
+        std::weak_ptr<const VelodyneLaserTable> table;
+    };
+    static std::vector<CachedTable> cache;
+    static CacheMutex cache_mutex;
+
+    uint64_t hash = fnv1a(FNV1A_OFFSET_BASIS, reinterpret_cast<const uint8_t *>(calib), sizeof(*calib));
+    // held while a missing table is built, so that concurrent users of a calibration build it once
+    CacheLock lock(cache_mutex);
+    for (CachedTable &cached : cache)
+    {
+        if (cached.hash == hash && cached.mode == mode && memcmp(&cached.calib, calib, sizeof(*calib)) == 0)
+        {
+            if (std::shared_ptr<const VelodyneLaserTable> table = cached.table.lock())
+            {
+                return table;
+            }
+        }
+    }
+    auto table = std::make_shared<VelodyneLaserTable>();
+    build_laser_table(calib, mode, table.get());
+    // drop entries whose tables have been freed
+    cache.erase(std::remove_if(cache.begin(), cache.end(), [](const CachedTable &cached)
+                               { return cached.table.expired(); }),
+                cache.end());
+    cache.push_back(CachedTable{.hash = hash, .mode = mode, .calib = *calib, .table = table});
+    return table;
+}
+
+/** Splits the 32 three-byte (range, intensity) records of a block into separate arrays. */
+void unpack_block(const uint8_t *records, uint16_t ranges[VELODYNE_LASERS_PER_BLOCK], uint8_t intensities[VELODYNE_LASERS_PER_BLOCK])
+{
+    // Each 16-byte load covers four records. The shuffle gathers their little-endian ranges into
+    // the low eight bytes and their intensities into the next four.
+#if defined(__wasm_simd128__)
+    const v128_t shuffle = wasm_i8x16_make(0, 1, 3, 4, 6, 7, 9, 10, 2, 5, 8, 11, -1, -1, -1, -1);
+    for (int i = 0; i < VELODYNE_LASERS_PER_BLOCK; i += 4)
+    {
+        v128_t v = wasm_i8x16_swizzle(wasm_v128_load(records + i * 3), shuffle);
+        wasm_v128_store64_lane(ranges + i, v, 0);
+        wasm_v128_store32_lane(intensities + i, v, 2);
+    }
+#elif defined(__SSSE3__)
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 3, 4, 6, 7, 9, 10, 2, 5, 8, 11, -1, -1, -1, -1);
+    for (int i = 0; i < VELODYNE_LASERS_PER_BLOCK; i += 4)
+    {
+        __m128i v = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(records + i * 3)), shuffle);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(ranges + i), v);
+        uint32_t packed = uint32_t(_mm_cvtsi128_si32(_mm_srli_si128(v, 8)));
+        memcpy(intensities + i, &packed, sizeof(packed));
+    }
+#else
+    for (int i = 0; i < VELODYNE_LASERS_PER_BLOCK; i++)
+    {
+        ranges[i] = uint16_t(records[i * 3] | (records[i * 3 + 1] << 8));
+        intensities[i] = records[i * 3 + 2];
+    }
+#endif
+}
+
+int32_t velodyne_decode_packet(const VelodyneLaserTable &table, const uint8_t *packet, size_t len, double min_range,
+                               VelodynePacketPoints *out)
+{
+    out->blocks = 0;
+    out->block_start[0] = 0;
+    if (len != VELODYNE_PACKET_LEN)
+    {
+        return -1;
+    }
+    int32_t count = 0;
+    for (int32_t b = 0; b < VELODYNE_BLOCKS_PER_PACKET; b++)
+    {
+        const uint8_t *block = packet + b * 100;
+        uint16_t magic = uint16_t(block[0] | (block[1] << 8));
+        if (magic != UPPER_MAGIC && magic != LOWER_MAGIC)
+        {
+            break;
+        }
+        int32_t laser_offset = magic == UPPER_MAGIC ? 32 : 0;
+        int32_t azimuth = block[2] | (block[3] << 8);
+        // corrupt azimuths past a full turn are decoded without the tables
+        VelodyneTableMode mode = azimuth < VELODYNE_AZIMUTHS ? table.mode : VelodyneTableMode::NONE;
+        double sin_ctheta;
+        double cos_ctheta;
+        if (mode == VelodyneTableMode::NONE)
+        {
+            sin_ctheta = sin(head_angle(azimuth));
+            cos_ctheta = cos(head_angle(azimuth));
+        }
+        else
+        {
+            sin_ctheta = table.azimuth_sincos[2 * azimuth];
+            cos_ctheta = table.azimuth_sincos[2 * azimuth + 1];
+        }
+
+        uint16_t raw_ranges[VELODYNE_LASERS_PER_BLOCK];
+        uint8_t intensities[VELODYNE_LASERS_PER_BLOCK];
+        unpack_block(block + 4, raw_ranges, intensities);
+
+        // Every laser of the block is decoded with the same straight-line arithmetic, then the ones
+        // out of range are compacted away without branching.
+        double x[VELODYNE_LASERS_PER_BLOCK];
+        double y[VELODYNE_LASERS_PER_BLOCK];
+        double z[VELODYNE_LASERS_PER_BLOCK];
+        double range[VELODYNE_LASERS_PER_BLOCK];
+        if (mode == VelodyneTableMode::FULL)
+        {
+            const float *direction = &table.directions[(size_t(azimuth) * VELODYNE_NUM_LASERS + laser_offset) * 2];
+            for (int i = 0; i < VELODYNE_LASERS_PER_BLOCK; i++)
+            {
+                int l = laser_offset + i;
+                range[i] = (raw_ranges[i] * METERS_PER_LSB + table.range_offset[l]) * table.range_scale[l];
+                x[i] = range[i] * direction[2 * i] - table.hcf[l] * cos_ctheta;
+                y[i] = range[i] * direction[2 * i + 1] - table.hcf[l] * sin_ctheta;
+                z[i] = range[i] * table.sin_vcf[l];
+            }
+        }
+        else
+        {
+            for (int i = 0; i < VELODYNE_LASERS_PER_BLOCK; i++)
+            {
+                int l = laser_offset + i;
+                range[i] = (raw_ranges[i] * METERS_PER_LSB + table.range_offset[l]) * table.range_scale[l];
+                // theta = ctheta + rcf
+                double sin_theta = sin_ctheta * table.cos_rcf[l] + cos_ctheta * table.sin_rcf[l];
+                double cos_theta = cos_ctheta * table.cos_rcf[l] - sin_ctheta * table.sin_rcf[l];
+                double planar = range[i] * table.cos_vcf[l];
+                x[i] = planar * cos_theta - table.hcf[l] * cos_ctheta;
+                y[i] = planar * sin_theta - table.hcf[l] * sin_ctheta;
+                z[i] = range[i] * table.sin_vcf[l];
+            }
+        }
+        for (int i = 0; i < VELODYNE_LASERS_PER_BLOCK; i++)
+        {
+            out->x[count] = x[i];
+            out->y[count] = y[i];
+            out->z[count] = z[i];
+            out->intensity[count] = intensities[i];
+            out->ring[count] = table.logical[laser_offset + i];
+            count += !(range[i] < min_range);
+        }
+        out->azimuth[b] = azimuth;
+        out->blocks = b + 1;
+        out->block_start[b + 1] = count;
+    }
+    return count;
+}
+
+void velodyne_transform_points(const double m[16], int32_t begin, int32_t end, VelodynePacketPoints *points)
+{
+    double *x = points->x;
+    double *y = points->y;
+    double *z = points->z;
+    int32_t i = begin;
+    // Two points at a time. The row coefficients are splatted once per call.
+#if defined(__wasm_simd128__)
+    v128_t r[12];
+    for (int k = 0; k < 12; k++)
+    {
+        r[k] = wasm_f64x2_splat(m[k]);
+    }
+    for (; i + 2 <= end; i += 2)
+    {
+        v128_t px = wasm_v128_load(x + i);
+        v128_t py = wasm_v128_load(y + i);
+        v128_t pz = wasm_v128_load(z + i);
+        for (int row = 0; row < 3; row++)
+        {
+            const v128_t *c = r + row * 4;
+            v128_t v = wasm_f64x2_add(wasm_f64x2_add(wasm_f64x2_mul(c[0], px), wasm_f64x2_mul(c[1], py)),
+                                      wasm_f64x2_add(wasm_f64x2_mul(c[2], pz), c[3]));
+            wasm_v128_store((row == 0 ? x : row == 1 ? y : z) + i, v);
+        }
+    }
+#elif defined(__SSE2__)
+    __m128d r[12];
+    for (int k = 0; k < 12; k++)
+    {
+        r[k] = _mm_set1_pd(m[k]);
+    }
+    for (; i + 2 <= end; i += 2)
+    {
+        __m128d px = _mm_loadu_pd(x + i);
+        __m128d py = _mm_loadu_pd(y + i);
+        __m128d pz = _mm_loadu_pd(z + i);
+        for (int row = 0; row < 3; row++)
+        {
+            const __m128d *c = r + row * 4;
+            __m128d v = _mm_add_pd(_mm_add_pd(_mm_mul_pd(c[0], px), _mm_mul_pd(c[1], py)),
+                                   _mm_add_pd(_mm_mul_pd(c[2], pz), c[3]));
+            _mm_storeu_pd((row == 0 ? x : row == 1 ? y : z) + i, v);
+        }
+    }
+#endif
+    for (; i < end; i++)
+    {
+        double px = x[i];
+        double py = y[i];
+        double pz = z[i];
+        x[i] = m[0] * px + m[1] * py + m[2] * pz + m[3];
+        y[i] = m[4] * px + m[5] * py + m[6] * pz + m[7];
+        z[i] = m[8] * px + m[9] * py + m[10] * pz + m[11];
+    }
+}
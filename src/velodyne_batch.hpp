@@ -0,0 +1,86 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "lcm/velodyne.h"
+
+/** Blocks of returns in each Velodyne packet. */
+constexpr int32_t VELODYNE_BLOCKS_PER_PACKET = 12;
+/** Laser returns in each block. */
+constexpr int32_t VELODYNE_LASERS_PER_BLOCK = 32;
+constexpr int32_t VELODYNE_POINTS_PER_PACKET = VELODYNE_BLOCKS_PER_PACKET * VELODYNE_LASERS_PER_BLOCK;
+constexpr size_t VELODYNE_PACKET_LEN = 1206;
+/** Distinct raw head azimuths, in hundredths of a degree. */
+constexpr int32_t VELODYNE_AZIMUTHS = 36000;
+
+/** How much of the per-point trigonometry is replaced by table lookups, trading memory for speed. */
+enum class VelodyneTableMode
+{
+    /** One sin/cos of the head azimuth per block. */
+    NONE,
+    /** Sin/cos of every head azimuth: 576 KB. */
+    AZIMUTH,
+    /** Also each laser's horizontal direction at every head azimuth, in float32: 18 MB per
+     * calibration, and coordinates rounded to about 1e-7 of the range. */
+    FULL,
+};
+
+/** Per-laser calibration terms, laid out as arrays indexed by physical laser so that a whole block
+ * can be decoded with straight-line arithmetic.
+ */
+struct VelodyneLaserTable
+{
+    double range_offset[VELODYNE_NUM_LASERS];
+    /** 1 + range_scale_offset */
+    double range_scale[VELODYNE_NUM_LASERS];
+    /** Rotational offset, applied to the head azimuth with the angle addition identities. */
+    double sin_rcf[VELODYNE_NUM_LASERS];
+    double cos_rcf[VELODYNE_NUM_LASERS];
+    double sin_vcf[VELODYNE_NUM_LASERS];
+    double cos_vcf[VELODYNE_NUM_LASERS];
+    double hcf[VELODYNE_NUM_LASERS];
+    uint8_t logical[VELODYNE_NUM_LASERS];
+
+    VelodyneTableMode mode;
+    /** For AZIMUTH and FULL, sin and cos of the head angle at each raw azimuth. */
+    std::vector<double> azimuth_sincos;
+    /** For FULL, cos(vcf) * cos(theta) and cos(vcf) * sin(theta) of each laser at each raw azimuth,
+     * indexed by azimuth, then physical laser. */
+    std::vector<float> directions;
+};
+
+void build_laser_table(const velodyne_calib_t *calib, VelodyneTableMode mode, VelodyneLaserTable *table);
+
+/** Returns a table for `calib` in `mode`, shared with every other user of the same calibration
+ * and mode for as long as any of them holds it. Safe to call from concurrent loaders. */
+std::shared_ptr<const VelodyneLaserTable> shared_laser_table(const velodyne_calib_t *calib, VelodyneTableMode mode);
+
+/** The returns of one Velodyne packet in structure-of-arrays form. Returns closer than the minimum
+ * range are left out, so the points of block `b` are those in [block_start[b], block_start[b + 1]).
+ */
+struct VelodynePacketPoints
+{
+    int32_t blocks;
+    /** Raw head azimuth of each block, in hundredths of a degree. */
+    int32_t azimuth[VELODYNE_BLOCKS_PER_PACKET];
+    int32_t block_start[VELODYNE_BLOCKS_PER_PACKET + 1];
+
+    double x[VELODYNE_POINTS_PER_PACKET];
+    double y[VELODYNE_POINTS_PER_PACKET];
+    double z[VELODYNE_POINTS_PER_PACKET];
+    uint8_t intensity[VELODYNE_POINTS_PER_PACKET];
+    /** Logical laser number, in order of increasing pitch. */
+    uint8_t ring[VELODYNE_POINTS_PER_PACKET];
+};
+
+/** Decodes a whole Velodyne packet, producing the same points as velodyne_decoder_next (to within
+ * rounding) without per-sample trig. Like velodyne_decoder_next, stops at the first block with an
+ * unknown magic. Returns the number of points, or -1 if `len` is not that of a packet.
+ */
+int32_t velodyne_decode_packet(const VelodyneLaserTable &table, const uint8_t *packet, size_t len, double min_range,
+                               VelodynePacketPoints *out);
+
+/** Applies the row-major rigid transform `m` to points [begin, end) of `points`. */
+void velodyne_transform_points(const double m[16], int32_t begin, int32_t end, VelodynePacketPoints *points);
@@ -0,0 +1,249 @@
+#include "velodyne_calib.hpp"
+#include "cache_mutex.hpp"
+#include "channel_table.hpp"
+
+#include "lcm/config.h"
+#include "lcm/math_util.h"
+#include "lcm/rotations.h"
+#include "lcm/small_linalg.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+std::shared_ptr<const VelodyneCalibration> default_velodyne_calibration()
+{
+    // precomputed on first use, then shared by every transcoder without a calibration file
+    static const std::shared_ptr<const VelodyneCalibration> calib = []()
+    {
+        auto calib = std::make_shared<VelodyneCalibration>();
+        velodyne_calib_t *lasers = velodyne_calib_create();
+        calib->lasers = *lasers;
+        free(lasers);
+        const double identity[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+        memcpy(calib->sensor_to_body, identity, sizeof(identity));
+        return calib;
+    }();
+    return calib;
+}
+
+Config *parse_config(const uint8_t *buf, size_t len, const std::string &path, std::string *error)
+{
+    if (len == 0)
+    {
+        return config_alloc();
+    }
+    // config.c only reads from a FILE, so hand it one over the bytes already fetched from the host.
+    FILE *file = fmemopen(const_cast<uint8_t *>(buf), len, "r");
+    if (file == nullptr)
+    {
+        *error = "failed to read " + path;
+        return nullptr;
+    }
+    std::vector<char> filename(path.begin(), path.end());
+    filename.push_back('\0');
+    Config *config = config_parse_file(file, filename.data());
+    fclose(file);
+    if (config == nullptr)
+    {
+        *error = "failed to parse " + path;
+    }
+    return config;
+}
+
+/** Reads `key` into the `len` values at `out`. Returns 0 if it is absent, 1 if it was read, or -1
+ * and sets `error` if it is not an array of `len` numbers. */
+int load_double_array(Config *config, const std::string &key, double *out, int len, std::string *error)
+{
+    if (!config_has_key(config, key.c_str()))
+    {
+        return 0;
+    }
+    if (config_get_array_len(config, key.c_str()) != len || config_get_double_array(config, key.c_str(), out, len) != len)
+    {
+        *error = key + " must be an array of " + std::to_string(len) + " numbers";
+        return -1;
+    }
+    return 1;
+}
+
+/** Copies `calibration.VELODYNE.<term>` into the `member` of every laser of `calib`, if present. */
+bool load_laser_term(Config *config, const char *term, double velodyne_laser_calib::*member, velodyne_calib_t *calib,
+                     std::string *error)
+{
+    std::string key = std::string("calibration.") + VELODYNE_CALIBRATION_SENSOR + "." + term;
+    double values[VELODYNE_NUM_LASERS];
+    int read = load_double_array(config, key, values, VELODYNE_NUM_LASERS, error);
+    if (read <= 0)
+    {
+        return read == 0;
+    }
+    for (int i = 0; i < VELODYNE_NUM_LASERS; i++)
+    {
+        calib->lasers[i].*member = values[i];
+    }
+    return true;
+}
+
+/** Reads the transform from frame `name` to the frame it is calibrated against into `m`, as
+ * config_util_get_matrix does, and sets `found` to whether the file gives both its position and its
+ * orientation. config_util formats keys into fixed-size buffers and asserts on the lengths of the
+ * arrays, so a malformed file would abort the module; here it returns false and sets `error`. */
+bool load_frame_matrix(Config *config, const std::string &name, double m[16], bool *found, std::string *error)
+{
+    std::string prefix = "calibration." + name + ".";
+    double quat[4];
+    int orientation = load_double_array(config, prefix + "orientation", quat, 4, error);
+    if (orientation == 0)
+    {
+        double rpy[3];
+        orientation = load_double_array(config, prefix + "rpy", rpy, 3, error);
+        if (orientation > 0)
+        {
+            for (double &angle : rpy)
+            {
+                angle = to_radians(angle);
+            }
+            rot_roll_pitch_yaw_to_quat(rpy, quat);
+        }
+    }
+    if (orientation == 0)
+    {
+        double angleaxis[4];
+        orientation = load_double_array(config, prefix + "angleaxis", angleaxis, 4, error);
+        if (orientation > 0)
+        {
+            double s = sin(angleaxis[0] / 2);
+            quat[0] = cos(angleaxis[0] / 2);
+            for (int i = 1; i < 4; i++)
+            {
+                quat[i] = angleaxis[i] * s;
+            }
+        }
+    }
+    if (orientation < 0)
+    {
+        return false;
+    }
+    double pos[3];
+    int position = load_double_array(config, prefix + "position", pos, 3, error);
+    if (position < 0)
+    {
+        return false;
+    }
+    *found = orientation > 0 && position > 0;
+    if (*found)
+    {
+        rot_quat_pos_to_matrix(quat, pos, m);
+    }
+    return true;
+}
+
+/** Reads the sensor's mounting into `sensor_to_body`, if the file gives one. */
+bool load_sensor_to_body(Config *config, double sensor_to_body[16], std::string *error)
+{
+    double sensor_to_calibration[16];
+    bool found = false;
+    if (!load_frame_matrix(config, VELODYNE_CALIBRATION_SENSOR, sensor_to_calibration, &found, error))
+    {
+        return false;
+    }
+    if (!found)
+    {
+        return true;
+    }
+    // like config_util_sensor_to_local_with_pose, the mounting may be given relative to another
+    // calibrated frame rather than the body
+    std::string key = std::string("calibration.") + VELODYNE_CALIBRATION_SENSOR + ".relative_to";
+    char *relative_to = nullptr;
+    if (config_get_str(config, key.c_str(), &relative_to) != 0 || strcmp(relative_to, "body") == 0)
+    {
+        memcpy(sensor_to_body, sensor_to_calibration, sizeof(sensor_to_calibration));
+        return true;
+    }
+    double calibration_to_body[16];
+    if (!load_frame_matrix(config, relative_to, calibration_to_body, &found, error))
+    {
+        return false;
+    }
+    if (!found)
+    {
+        *error = key + " names " + relative_to + ", which has no calibration";
+        return false;
+    }
+    matrix_multiply_4x4_4x4(calibration_to_body, sensor_to_calibration, sensor_to_body);
+    return true;
+}
+
+std::shared_ptr<VelodyneCalibration> parse_velodyne_calibration(const uint8_t *buf, size_t len, const std::string &path,
+                                                             std::string *error)
+{
+    auto calib = std::make_shared<VelodyneCalibration>(*default_velodyne_calibration());
+    Config *config = parse_config(buf, len, path, error);
+    if (config == nullptr)
+    {
+        return nullptr;
+    }
+    velodyne_calib_t *lasers = &calib->lasers;
+    bool ok = load_laser_term(config, "rcf", &velodyne_laser_calib::rcf, lasers, error) &&
+              load_laser_term(config, "vcf", &velodyne_laser_calib::vcf, lasers, error) &&
+              load_laser_term(config, "hcf", &velodyne_laser_calib::hcf, lasers, error) &&
+              load_laser_term(config, "range_offset", &velodyne_laser_calib::range_offset, lasers, error) &&
+              load_laser_term(config, "range_scale_offset", &velodyne_laser_calib::range_scale_offset, lasers, error) &&
+              load_sensor_to_body(config, calib->sensor_to_body, error);
+    config_free(config);
+    if (!ok)
+    {
+        return nullptr;
+    }
+    // the logical laser order and sin/cos of each laser's pitch follow from the new vcf
+    velodyne_calib_precompute(lasers);
+    return calib;
+}
+
+std::shared_ptr<const VelodyneCalibration> load_velodyne_calibration(const uint8_t *buf, size_t len, const std::string &path,
+                                                                     std::string *error)
+{
+    struct CachedCalibration
+    {
+        uint64_t hash;
+        /** The file, compared on a hash match so that a collision cannot hand out the wrong
+         * calibration. Calibration files are a few kilobytes. */
+        std::vector<uint8_t> contents;
+        std::weak_ptr<const VelodyneCalibration> calib;
+    };
+    static std::vector<CachedCalibration> cache;
+    static CacheMutex cache_mutex;
+
+    if (buf == nullptr && len > 0)
+    {
+        *error = "failed to read " + path;
+        return nullptr;
+    }
+    uint64_t hash = fnv1a(FNV1A_OFFSET_BASIS, buf, len);
+    CacheLock lock(cache_mutex);
+    for (CachedCalibration &cached : cache)
+    {
+        if (cached.hash == hash && cached.contents.size() == len && (len == 0 || memcmp(cached.contents.data(), buf, len) == 0))
+        {
+            if (std::shared_ptr<const VelodyneCalibration> calib = cached.calib.lock())
+            {
+                return calib;
+            }
+        }
+    }
+    std::shared_ptr<const VelodyneCalibration> calib = parse_velodyne_calibration(buf, len, path, error);
+    if (calib == nullptr)
+    {
+        return nullptr;
+    }
+    // drop entries whose calibrations have been freed
+    cache.erase(std::remove_if(cache.begin(), cache.end(), [](const CachedCalibration &cached)
+                               { return cached.calib.expired(); }),
+                cache.end());
+    cache.push_back(CachedCalibration{.hash = hash, .contents = std::vector<uint8_t>(buf, buf + len), .calib = calib});
+    return calib;
+}
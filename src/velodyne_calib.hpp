@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "lcm/config.h"
+#include "lcm/velodyne.h"
+
+/** A calibration file can be opened alongside the log, in the format read by lcm/config.c. */
+constexpr const char *CALIBRATION_SUFFIX = ".cfg";
+
+/** Sensor whose `calibration.<sensor>.*` keys hold the Velodyne's per-laser calibration. */
+constexpr const char *VELODYNE_CALIBRATION_SENSOR = "VELODYNE";
+
+/** Parses the contents of a file in the format of lcm/config.c. Returns nullptr and sets `error` if
+ * it cannot be parsed. The result is freed with config_free(). */
+Config *parse_config(const uint8_t *buf, size_t len, const std::string &path, std::string *error);
+
+/** A Velodyne's per-laser calibration and its mounting on the vehicle. */
+struct VelodyneCalibration
+{
+    velodyne_calib_t lasers;
+    /** Row-major rigid transform from the sensor frame to the vehicle body frame. Identity unless
+     * the calibration file gives `calibration.VELODYNE.position` and an orientation. */
+    double sensor_to_body[16];
+};
+
+/** The calibration compiled into velodyne.c, which is used when no calibration file is given. It is
+ * precomputed once and shared by every caller. */
+std::shared_ptr<const VelodyneCalibration> default_velodyne_calibration();
+
+/** Parses a calibration file and compiles its Velodyne calibration. Each of
+ * `calibration.VELODYNE.{rcf,vcf,hcf,range_offset,range_scale_offset}` may hold an array with a
+ * value for each of the 64 physical lasers, in the units of velodyne_laser_calib. Terms that are
+ * absent keep their compiled-in values. The sensor's mounting is read like config_util does, from
+ * `calibration.VELODYNE.{position,orientation|rpy|angleaxis,relative_to}`.
+ *
+ * Calibrations are cached by the contents of the file, so every loader that opens the same
+ * file shares one compiled calibration, including loaders on other threads. Returns nullptr and
+ * sets `error` if the file cannot be parsed or one of these keys holds the wrong number of values.
+ */
+std::shared_ptr<const VelodyneCalibration> load_velodyne_calibration(const uint8_t *buf, size_t len, const std::string &path,
+                                                                     std::string *error);
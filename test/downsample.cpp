@@ -0,0 +1,46 @@
+// downsample: checks that copy_within_budget spreads the points it keeps evenly over messages large
+// enough that k * count overflows 32 bits, as whole sweeps do under the default max_points.
+//
+// usage: downsample [log]   (the log is ignored)
+#include "bench.hpp"
+#include "downsample.hpp"
+
+/** Thins `count` numbered points to `max_points`, and checks that the k-th point kept is the
+ * floor(k * count / kept)-th. */
+bool check_budget(size_t count, int32_t max_points)
+{
+  std::vector<uint32_t> in(count);
+  for (size_t i = 0; i < count; i++)
+  {
+    in[i] = uint32_t(i);
+  }
+  size_t kept = points_within_budget(count, max_points);
+  std::vector<uint32_t> out(kept);
+  size_t copied = copy_within_budget(reinterpret_cast<const uint8_t *>(in.data()), count, sizeof(uint32_t), max_points,
+                                     reinterpret_cast<uint8_t *>(out.data()));
+  bool ok = copied == kept;
+  for (size_t k = 0; ok && k < kept; k++)
+  {
+    uint64_t expected = uint64_t(k) * count / kept;
+    if (out[k] != expected)
+    {
+      printf("  point %zu kept is %u, expected %llu\n", k, out[k], (unsigned long long)expected);
+      ok = false;
+    }
+  }
+  printf("%zu points within %d: %zu kept, %s\n", count, max_points, kept, ok ? "ok" : "FAILED");
+  return ok;
+}
+
+int main()
+{
+  bool ok = true;
+  // a few packets, which fit
+  ok &= check_budget(40000, 50000);
+  // just past 2^32 / kept, and a 64-laser sweep of about 130k points
+  ok &= check_budget(86000, 50000);
+  ok &= check_budget(130000, 50000);
+  // k * count passes 2^32 many times over
+  ok &= check_budget(1000003, 50000);
+  return ok ? 0 : 1;
+}
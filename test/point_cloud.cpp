@@ -0,0 +1,312 @@
+// point_cloud: checks the PointCloud messages of each PointLayout: the point stride and the packed
+// fields they advertise, and that every point read back through those fields is the decoded point.
+// Also checks that the `pointcloud.*` keys are read from a calibration file.
+//
+// usage: point_cloud [log]   (the log is ignored)
+#include "bench.hpp"
+#include "lcm/lcmtypes_velodyne_t.h"
+#include "transcode.hpp"
+
+/** Values of foxglove.PackedElementField.NumericType. */
+constexpr uint64_t UINT8 = 1;
+constexpr uint64_t UINT16 = 3;
+constexpr uint64_t FLOAT32 = 7;
+constexpr uint64_t FLOAT64 = 8;
+
+struct Field
+{
+  std::string name;
+  uint64_t offset;
+  uint64_t type;
+
+  bool operator==(const Field &other) const
+  {
+    return name == other.name && offset == other.offset && type == other.type;
+  }
+};
+
+/** The parts of an encoded foxglove.PointCloud that describe its points. */
+struct ParsedCloud
+{
+  uint32_t point_stride = 0;
+  std::vector<Field> fields;
+  const uint8_t *data = nullptr;
+  size_t data_len = 0;
+};
+
+/** Steps through the fields of an encoded protobuf message. */
+struct ProtoReader
+{
+  const uint8_t *p;
+  const uint8_t *end;
+
+  bool done() const { return p >= end; }
+
+  uint64_t varint()
+  {
+    uint64_t v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7)
+    {
+      uint8_t byte = *p++;
+      v |= uint64_t(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0)
+      {
+        break;
+      }
+    }
+    return v;
+  }
+
+  /** Reads the next field's number and its value: varints and fixed32s into `value`, and fixed and
+   * length-delimited fields as bytes into `bytes` and `len`. */
+  bool next(uint32_t *number, uint64_t *value, const uint8_t **bytes, size_t *len)
+  {
+    uint64_t tag = varint();
+    *number = uint32_t(tag >> 3);
+    size_t size = 0;
+    switch (tag & 7)
+    {
+    case 0:
+      *value = varint();
+      return true;
+    case 1:
+      size = 8;
+      break;
+    case 2:
+      size = size_t(varint());
+      break;
+    case 5:
+      size = 4;
+      if (size_t(end - p) >= size)
+      {
+        *value = uint64_t(p[0]) | (uint64_t(p[1]) << 8) | (uint64_t(p[2]) << 16) | (uint64_t(p[3]) << 24);
+      }
+      break;
+    default:
+      return false;
+    }
+    if (size_t(end - p) < size)
+    {
+      return false;
+    }
+    *bytes = p;
+    *len = size;
+    p += size;
+    return true;
+  }
+};
+
+constexpr uint32_t POINT_CLOUD_POINT_STRIDE = 4;
+constexpr uint32_t POINT_CLOUD_FIELDS = 5;
+constexpr uint32_t POINT_CLOUD_DATA = 6;
+
+bool parse_point_cloud(const std::vector<uint8_t> &message, ParsedCloud *cloud)
+{
+  ProtoReader reader{message.data(), message.data() + message.size()};
+  while (!reader.done())
+  {
+    uint32_t number;
+    uint64_t value = 0;
+    const uint8_t *bytes = nullptr;
+    size_t len = 0;
+    if (!reader.next(&number, &value, &bytes, &len))
+    {
+      return false;
+    }
+    if (number == POINT_CLOUD_POINT_STRIDE)
+    {
+      cloud->point_stride = uint32_t(value);
+    }
+    else if (number == POINT_CLOUD_FIELDS)
+    {
+      Field field{};
+      ProtoReader inner{bytes, bytes + len};
+      while (!inner.done())
+      {
+        uint32_t inner_number;
+        uint64_t inner_value = 0;
+        const uint8_t *inner_bytes = nullptr;
+        size_t inner_len = 0;
+        if (!inner.next(&inner_number, &inner_value, &inner_bytes, &inner_len))
+        {
+          return false;
+        }
+        if (inner_number == 1)
+        {
+          field.name.assign(reinterpret_cast<const char *>(inner_bytes), inner_len);
+        }
+        else if (inner_number == 2)
+        {
+          field.offset = inner_value;
+        }
+        else if (inner_number == 3)
+        {
+          field.type = inner_value;
+        }
+      }
+      cloud->fields.push_back(field);
+    }
+    else if (number == POINT_CLOUD_DATA)
+    {
+      cloud->data = bytes;
+      cloud->data_len = len;
+    }
+  }
+  return true;
+}
+
+/** Reads the field of `type` at `p` as a double. */
+double read_field(const uint8_t *p, uint64_t type)
+{
+  switch (type)
+  {
+  case UINT8:
+    return p[0];
+  case UINT16:
+  {
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+  }
+  case FLOAT32:
+  {
+    float v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+  }
+  default:
+  {
+    double v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+  }
+  }
+}
+
+/** The value that `field` of point `i`, in `block`, should hold. */
+double decoded_value(const VelodynePacketPoints &points, int32_t block, int32_t i, const Field &field)
+{
+  double v = points.intensity[i];
+  if (field.name == "x")
+  {
+    v = points.x[i];
+  }
+  else if (field.name == "y")
+  {
+    v = points.y[i];
+  }
+  else if (field.name == "z")
+  {
+    v = points.z[i];
+  }
+  else if (field.name == "ring")
+  {
+    v = points.ring[i];
+  }
+  else if (field.name == "azimuth")
+  {
+    v = points.azimuth[block];
+  }
+  else if (field.type == FLOAT64)
+  {
+    // float64 intensities are scaled to [0, 1]
+    v /= 255.0;
+  }
+  return field.type == FLOAT32 ? double(float(v)) : v;
+}
+
+struct LayoutCase
+{
+  const char *name;
+  PointLayout layout;
+  uint32_t stride;
+  std::vector<Field> fields;
+};
+
+/** Transcodes `event` in `layout`, and checks the message against what the layout promises. */
+bool check_layout(const LayoutCase &expected, const std::vector<uint8_t> &event)
+{
+  Transcoder transcoder;
+  transcoder.point_layout = expected.layout;
+  VelodyneView vel;
+  std::vector<uint8_t> message;
+  ParsedCloud cloud;
+  if (!view_velodyne(event.data(), event.size(), &vel) ||
+      transcoder.transcode_point_cloud(vel, &message, "velodyne", PointCloudStages{}) < 0 ||
+      !parse_point_cloud(message, &cloud))
+  {
+    printf("%s: failed to transcode\n", expected.name);
+    return false;
+  }
+  const VelodynePacketPoints &points = transcoder.velodyne_points;
+  size_t count = size_t(points.block_start[points.blocks]);
+  bool ok = cloud.point_stride == expected.stride && point_stride(expected.layout) == expected.stride &&
+            cloud.fields == expected.fields && cloud.data_len == count * expected.stride;
+  for (int32_t block = 0; ok && block < points.blocks; block++)
+  {
+    for (int32_t i = points.block_start[block]; ok && i < points.block_start[block + 1]; i++)
+    {
+      const uint8_t *point = cloud.data + size_t(i) * cloud.point_stride;
+      for (const Field &field : cloud.fields)
+      {
+        double v = read_field(point + field.offset, field.type);
+        double want = decoded_value(points, block, i, field);
+        if (v != want)
+        {
+          printf("  point %d field %s is %g, expected %g\n", i, field.name.c_str(), v, want);
+          ok = false;
+        }
+      }
+    }
+  }
+  printf("%s: stride %u, %zu fields, %zu points, %s\n", expected.name, cloud.point_stride, cloud.fields.size(), count,
+         ok ? "ok" : "FAILED");
+  return ok;
+}
+
+/** Checks what load_point_cloud_config makes of a file holding `text`. */
+bool check_config(const char *text, bool expect_ok, PointCloudConfig expect = {})
+{
+  PointCloudConfig config;
+  std::string error;
+  bool ok = load_point_cloud_config(reinterpret_cast<const uint8_t *>(text), strlen(text), "test.cfg", &config, &error);
+  bool passed = ok == expect_ok && (!ok || (config.layout == expect.layout && config.table_mode == expect.table_mode));
+  printf("config \"%s\": %s%s\n", text, ok ? "read" : error.c_str(), passed ? ", ok" : ", FAILED");
+  return passed;
+}
+
+int main()
+{
+  uint8_t packet[VELODYNE_PACKET_LEN];
+  std::mt19937 rng(1);
+  make_velodyne_packet(rng, false, packet);
+  lcmtypes_velodyne_t msg = {
+      .utime = 1000000000,
+      .datalen = int32_t(VELODYNE_PACKET_LEN),
+      .data = packet,
+  };
+  std::vector<uint8_t> event(size_t(lcmtypes_velodyne_t_encoded_size(&msg)));
+  lcmtypes_velodyne_t_encode(event.data(), 0, int(event.size()), &msg);
+
+  const LayoutCase layouts[] = {
+      {"xyzi_f32", PointLayout::XYZI_F32, 13, {{"x", 0, FLOAT32}, {"y", 4, FLOAT32}, {"z", 8, FLOAT32}, {"intensity", 12, UINT8}}},
+      {"xyzi_f64", PointLayout::XYZI_F64, 32, {{"x", 0, FLOAT64}, {"y", 8, FLOAT64}, {"z", 16, FLOAT64}, {"intensity", 24, FLOAT64}}},
+      {"xyzira_f32",
+       PointLayout::XYZIRA_F32,
+       16,
+       {{"x", 0, FLOAT32}, {"y", 4, FLOAT32}, {"z", 8, FLOAT32}, {"intensity", 12, UINT8}, {"ring", 13, UINT8}, {"azimuth", 14, UINT16}}},
+  };
+  bool ok = true;
+  for (const LayoutCase &layout : layouts)
+  {
+    ok &= check_layout(layout, event);
+  }
+  ok &= check_config("", true);
+  ok &= check_config("pointcloud { layout = \"xyzi_f64\"; }", true, {.layout = PointLayout::XYZI_F64});
+  ok &= check_config("pointcloud { layout = \"xyzira_f32\"; tables = \"full\"; }", true,
+                     {.layout = PointLayout::XYZIRA_F32, .table_mode = VelodyneTableMode::FULL});
+  ok &= check_config("pointcloud { tables = \"none\"; }", true, {.table_mode = VelodyneTableMode::NONE});
+  ok &= check_config("pointcloud { layout = \"xyz\"; }", false);
+  ok &= check_config("pointcloud { tables = \"fast\"; }", false);
+  return ok ? 0 : 1;
+}
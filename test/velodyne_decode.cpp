@@ -0,0 +1,160 @@
+// velodyne_decode: checks that velodyne_decode_packet produces the points of velodyne_decoder_next,
+// to within rounding, in each VelodyneTableMode, on synthetic packets and on the VELODYNE packets of
+// an optional log.
+//
+// usage: velodyne_decode [log]
+#include "bench.hpp"
+#include "event_log.hpp"
+#include "lcm_views.hpp"
+#include "velodyne_batch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+
+/** As in the transcoder. */
+constexpr double VELODYNE_MIN_RANGE = 0.01;
+
+/** Largest difference allowed in each coordinate, relative to the range of the return. The batch
+ * decoder applies the laser's rotational offset with the angle addition identities rather than a
+ * sin and cos of the sum, which rounds differently. The FULL tables store directions as float32. */
+constexpr double TOLERANCE = 1e-12;
+constexpr double FULL_TABLE_TOLERANCE = 2.5e-7;
+
+constexpr int SYNTHETIC_PACKETS = 20000;
+
+struct Comparison
+{
+  double tolerance;
+  size_t packets = 0;
+  size_t points = 0;
+  size_t failures = 0;
+  /** Largest difference seen, relative to range. */
+  double max_error = 0;
+};
+
+/** Compares the decoders on one packet. The points that differ are printed for the first packet that fails. */
+void compare_packet(velodyne_calib_t *calib, const VelodyneLaserTable &table, const uint8_t *packet,
+                    Comparison *comparison)
+{
+  static VelodynePacketPoints points;
+  int32_t count = velodyne_decode_packet(table, packet, VELODYNE_PACKET_LEN, VELODYNE_MIN_RANGE, &points);
+
+  velodyne_decoder_t decoder;
+  velodyne_decoder_init(calib, &decoder, packet, int(VELODYNE_PACKET_LEN));
+  velodyne_sample_t sample;
+  int32_t expected = 0;
+  bool failed = false;
+  while (velodyne_decoder_next(calib, &decoder, &sample) == 0)
+  {
+    if (sample.range < VELODYNE_MIN_RANGE)
+    {
+      continue;
+    }
+    if (expected >= count)
+    {
+      failed = true;
+      break;
+    }
+    double error = std::max({std::abs(points.x[expected] - sample.xyz[0]), std::abs(points.y[expected] - sample.xyz[1]),
+                             std::abs(points.z[expected] - sample.xyz[2])}) /
+                   std::max(sample.range, 1.0);
+    comparison->max_error = std::max(comparison->max_error, error);
+    if (error > comparison->tolerance || points.intensity[expected] != uint8_t(std::lround(sample.intensity * 255)) ||
+        points.ring[expected] != sample.logical)
+    {
+      if (comparison->failures == 0)
+      {
+        fprintf(stderr, "point %d differs: (%.17g, %.17g, %.17g) intensity %d ring %d, expected (%.17g, %.17g, %.17g) intensity %d ring %d\n",
+                expected, points.x[expected], points.y[expected], points.z[expected], points.intensity[expected],
+                points.ring[expected], sample.xyz[0], sample.xyz[1], sample.xyz[2], int(std::lround(sample.intensity * 255)),
+                sample.logical);
+      }
+      failed = true;
+    }
+    expected++;
+  }
+  if (expected != count)
+  {
+    if (comparison->failures == 0)
+    {
+      fprintf(stderr, "decoded %d points, expected %d\n", count, expected);
+    }
+    failed = true;
+  }
+  comparison->packets++;
+  comparison->points += size_t(expected);
+  comparison->failures += failed;
+}
+
+bool report(const char *mode, const char *source, const Comparison &comparison)
+{
+  printf("%s tables, %s: %zu packets, %zu points, max error %.2g of range, %zu failed\n", mode, source,
+         comparison.packets, comparison.points, comparison.max_error, comparison.failures);
+  return comparison.failures == 0;
+}
+
+int main(int argc, char **argv)
+{
+  velodyne_calib_t *calib = velodyne_calib_create();
+  std::vector<uint8_t> log;
+  if (argc > 1)
+  {
+    std::ifstream in(argv[1], std::ios::binary);
+    log.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+
+  const std::pair<VelodyneTableMode, const char *> modes[] = {
+      {VelodyneTableMode::NONE, "none"},
+      {VelodyneTableMode::AZIMUTH, "azimuth"},
+      {VelodyneTableMode::FULL, "full"},
+  };
+  bool ok = true;
+  for (auto [mode, name] : modes)
+  {
+    VelodyneLaserTable table;
+    build_laser_table(calib, mode, &table);
+    double tolerance = mode == VelodyneTableMode::FULL ? FULL_TABLE_TOLERANCE : TOLERANCE;
+
+    Comparison synthetic{.tolerance = tolerance};
+    std::mt19937 rng(1);
+    uint8_t packet[VELODYNE_PACKET_LEN];
+    for (int i = 0; i < SYNTHETIC_PACKETS; i++)
+    {
+      make_velodyne_packet(rng, true, packet);
+      compare_packet(calib, table, packet, &synthetic);
+    }
+    ok &= report(name, "synthetic", synthetic);
+
+    if (argc > 1)
+    {
+      Comparison logged{.tolerance = tolerance};
+      LCMEvent event;
+      VelodyneView vel;
+      size_t pos = 0;
+      int64_t len;
+      while ((len = read_next(log.data() + pos, log.size() - pos, &event)) > 0)
+      {
+        pos += size_t(len);
+        if (view_velodyne(event.data.ptr, event.data.len, &vel) && vel.data.size_bytes() == VELODYNE_PACKET_LEN)
+        {
+          compare_packet(calib, table, vel.data.data, &logged);
+        }
+      }
+      ok &= report(name, argv[1], logged);
+    }
+  }
+
+  // tables are shared only between identical calibrations
+  std::shared_ptr<const VelodyneLaserTable> shared = shared_laser_table(calib, VelodyneTableMode::NONE);
+  velodyne_calib_t changed = *calib;
+  changed.lasers[0].hcf += 0.01;
+  bool shared_ok = shared_laser_table(calib, VelodyneTableMode::NONE) == shared &&
+                   shared_laser_table(&changed, VelodyneTableMode::NONE) != shared &&
+                   shared_laser_table(calib, VelodyneTableMode::AZIMUTH) != shared;
+  printf("shared tables: %s\n", shared_ok ? "ok" : "failed");
+  ok &= shared_ok;
+  free(calib);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,145 @@
+// lcm-index: pre-builds the sidecar index files read by the LCM data loader.
+//
+// usage: lcm-index [-f] <log or directory>...
+//
+// Directories are searched recursively for LCM logs. Logs whose index already matches their size
+// and modification time are skipped unless -f is given.
+#include "log_index.hpp"
+
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+namespace fs = std::filesystem;
+
+constexpr size_t SCAN_WINDOW_SIZE = 4 * 1024 * 1024;
+
+bool is_lcm_log(const fs::path &path)
+{
+  if (path.extension() == LOG_INDEX_SUFFIX)
+  {
+    return false;
+  }
+  uint8_t magic[4] = {0};
+  FILE *f = fopen(path.c_str(), "rb");
+  if (f == nullptr)
+  {
+    return false;
+  }
+  size_t n = fread(magic, 1, sizeof(magic), f);
+  fclose(f);
+  return n == sizeof(magic) && magic[0] == 0xED && magic[1] == 0xA1 && magic[2] == 0xDA && magic[3] == 0x01;
+}
+
+bool read_existing_index(const std::string &index_path, LogIndex *index)
+{
+  std::ifstream in(index_path, std::ios::binary);
+  if (!in)
+  {
+    return false;
+  }
+  std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  return deserialize_log_index(data.data(), data.size(), index);
+}
+
+/** Returns 0 if the index was written or is already up to date. */
+int index_log(const std::string &log_path, bool force)
+{
+  struct stat st;
+  if (stat(log_path.c_str(), &st) != 0)
+  {
+    fprintf(stderr, "%s: %s\n", log_path.c_str(), strerror(errno));
+    return 1;
+  }
+  int64_t mtime_ns = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+  std::string index_path = log_path + LOG_INDEX_SUFFIX;
+
+  LogIndex index;
+  if (!force && read_existing_index(index_path, &index) &&
+      index.file_size == uint64_t(st.st_size) && index.file_mtime_ns == mtime_ns)
+  {
+    printf("%s: up to date\n", index_path.c_str());
+    return 0;
+  }
+
+  WindowedReader reader(foxglove_data_loader::Reader::open(log_path.c_str()), SCAN_WINDOW_SIZE);
+  int64_t result = scan_log(reader, &index);
+  if (result < 0)
+  {
+    fprintf(stderr, "%s: failed to decode LCM log: %s\n", log_path.c_str(),
+            result == UNEXPECTED_EOF ? "unexpected EOF" : "malformed event");
+    return 1;
+  }
+  for (const SkippedRange &range : index.skipped)
+  {
+    fprintf(stderr, "%s: skipped %llu corrupt bytes at offset %llu\n", log_path.c_str(),
+            (unsigned long long)(range.end - range.start), (unsigned long long)range.start);
+  }
+  index.file_mtime_ns = mtime_ns;
+  std::vector<uint8_t> data = serialize_log_index(index);
+
+  // write to a temporary file first so that a reader never sees a partial index
+  std::string tmp_path = index_path + ".tmp";
+  {
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(data.data()), std::streamsize(data.size()));
+    if (!out)
+    {
+      fprintf(stderr, "%s: failed to write index\n", tmp_path.c_str());
+      return 1;
+    }
+  }
+  if (rename(tmp_path.c_str(), index_path.c_str()) != 0)
+  {
+    fprintf(stderr, "%s: %s\n", index_path.c_str(), strerror(errno));
+    return 1;
+  }
+  printf("%s: %zu events on %zu channels, %zu bytes\n", index_path.c_str(), index.events.size(),
+         index.channels.size(), data.size());
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  bool force = false;
+  std::vector<std::string> logs;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-f") == 0)
+    {
+      force = true;
+      continue;
+    }
+    std::error_code ec;
+    if (fs::is_directory(argv[i], ec))
+    {
+      for (const fs::directory_entry &entry : fs::recursive_directory_iterator(argv[i], ec))
+      {
+        if (entry.is_regular_file() && is_lcm_log(entry.path()))
+        {
+          logs.push_back(entry.path().string());
+        }
+      }
+    }
+    else
+    {
+      logs.push_back(argv[i]);
+    }
+  }
+  if (logs.empty())
+  {
+    fprintf(stderr, "usage: lcm-index [-f] <log or directory>...\n");
+    return 2;
+  }
+
+  int failures = 0;
+  for (const std::string &log : logs)
+  {
+    failures += index_log(log, force);
+  }
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,51 @@
+// Native implementation of the foxglove_data_loader::Reader host interface, so that code written
+// against it (like WindowedReader and scan_log) can run in command-line tools.
+#include "foxglove_data_loader/data_loader.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace foxglove_data_loader;
+
+// Reader has no way to release its handle. Tools only ever read one file at a time, so opening a
+// file closes the previously opened one.
+static int32_t open_fd = -1;
+
+Reader Reader::open(const char *path)
+{
+  if (open_fd >= 0)
+  {
+    ::close(open_fd);
+  }
+  open_fd = ::open(path, O_RDONLY);
+  return Reader(open_fd);
+}
+
+uint64_t Reader::seek(uint64_t pos)
+{
+  off_t result = ::lseek(handle, off_t(pos), SEEK_SET);
+  return result < 0 ? 0 : uint64_t(result);
+}
+
+uint64_t Reader::size()
+{
+  struct stat st;
+  if (handle < 0 || ::fstat(handle, &st) != 0)
+  {
+    return 0;
+  }
+  return uint64_t(st.st_size);
+}
+
+uint64_t Reader::position()
+{
+  off_t result = ::lseek(handle, 0, SEEK_CUR);
+  return result < 0 ? 0 : uint64_t(result);
+}
+
+uint64_t Reader::read(uint8_t *target, size_t len)
+{
+  ssize_t n = ::read(handle, target, len);
+  return n < 0 ? 0 : uint64_t(n);
+}